@@ -2,7 +2,7 @@
     Prints the induced 6-cycle count of simple bipartite graphs
 
     To run:
-        g++ -o BTJ BTJ.cpp preProcessing.cpp utilities.cpp -std=c++17 -O3 -fopenmp -ltbb
+        g++ -o BTJ BTJ.cpp preProcessing.cpp intersect.cpp compress.cpp utilities.cpp -std=c++17 -O3 -fopenmp -ltbb -lz
         ./BTJ <path_to_dataset> <partition_size?>
     
     Note that partition_size is optional; it defaults to processing all nodes.
@@ -22,29 +22,362 @@
 
 #include "main.h"
 
-uint64_t intersection_size (const std::vector<uint32_t>& s1, const std::vector<uint32_t>& s2) {
-  uint64_t result = 0;
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
-  std::vector<uint32_t>::const_iterator first1 = s1.begin();
-  std::vector<uint32_t>::const_iterator last1 = s1.end();
-  std::vector<uint32_t>::const_iterator first2 = s2.begin();
-  std::vector<uint32_t>::const_iterator last2 = s2.end();
+/*
+Counts |N(a) and N(c)| of one a by c while the wedges of a are enumerated
+Open addressing with the keys in groups of AC_GROUP that are probed with one SIMD compare, and 
+counters of one byte that are widened to two, then four, when one of them overflows, so a 
+table takes 5 bytes per slot (at most 3/4 full) while most counts are small
+Tables are only grown or rebuilt, never erased from, so a group with an empty slot ends a probe
+*/
+const uint32_t AC_GROUP = 4;
+const uint32_t AC_EMPTY = UINT32_MAX;
+
+struct acTable {
+    uint32_t *keys = NULL;
+    uint32_t capacity = 0;
+    uint32_t size = 0;
+    uint32_t width = 1;
+
+    acTable() = default;
+    acTable(const acTable&) = delete;
+    acTable& operator=(const acTable&) = delete;
+    acTable(acTable&& other) {*this = std::move(other);}
+    acTable& operator=(acTable&& other) {
+        std::swap(keys, other.keys);
+        std::swap(capacity, other.capacity);
+        std::swap(size, other.size);
+        std::swap(width, other.width);
+        return *this;
+    }
+    ~acTable() {delete[] (uint8_t *) keys;}
 
-  while (first1 != last1 && first2 != last2)
-  {
-    if (*first1 > *first2) ++first1;
-    else if (*first2 > *first1) ++first2;
-    else {
-      result += 1;
-      ++first1;
-      ++first2;
+    // the counters follow the keys in the same allocation
+    uint8_t *counters() const {return (uint8_t *) (keys + capacity);}
+
+    uint32_t counter(const uint32_t i) const {
+        if (width == 1) return counters()[i];
+        if (width == 2) return ((uint16_t *) counters())[i];
+        return ((uint32_t *) counters())[i];
+    }
+
+    void setCounter(const uint32_t i, const uint32_t value) {
+        if (width == 1) counters()[i] = value;
+        else if (width == 2) ((uint16_t *) counters())[i] = value;
+        else ((uint32_t *) counters())[i] = value;
+    }
+
+    // the slot holding x, or if there is none, the slot x would be inserted in; the table must not be empty
+    uint32_t probe(const uint32_t x) const {
+        const uint32_t mask = capacity / AC_GROUP - 1;
+        uint32_t group = (x * 2654435761u) & mask;
+        while (true) {
+            const uint32_t *k = keys + group * AC_GROUP;
+#if defined(__SSE2__)
+            const __m128i block = _mm_loadu_si128((const __m128i *) k);
+            const int hit = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(block, _mm_set1_epi32(x))));
+            if (hit != 0) {
+                return group * AC_GROUP + __builtin_ctz(hit);
+            }
+            const int empty = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(block, _mm_set1_epi32(AC_EMPTY))));
+            if (empty != 0) {
+                return group * AC_GROUP + __builtin_ctz(empty);
+            }
+#else
+            for (uint32_t j = 0; j < AC_GROUP; ++j) {
+                if (k[j] == x) {
+                    return group * AC_GROUP + j;
+                }
+                if (k[j] == AC_EMPTY) {
+                    return group * AC_GROUP + j;
+                }
+            }
+#endif
+            group = (group + 1) & mask;
+        }
+    }
+
+    // calls f(x, |N(a) and N(x)|) for every x in the table
+    template <typename F>
+    void forEach(F f) const {
+        for (uint32_t i = 0; i < capacity; ++i) {
+            if (keys[i] != AC_EMPTY) {
+                f(keys[i], counter(i));
+            }
+        }
     }
-  }
-  return result;
+
+    void increment(const uint32_t x) {
+        if (4 * (uint64_t) (size + 1) > 3 * (uint64_t) capacity) {
+            rebuild(std::max(2 * capacity, AC_GROUP), width);
+        }
+        const uint32_t i = probe(x);
+        if (keys[i] == AC_EMPTY) {
+            keys[i] = x;
+            ++size;
+        }
+        const uint32_t value = counter(i) + 1;
+        if (width < 4 && value >> (8 * width) != 0) {
+            // x is already in the table, so incrementing it again after widening cannot overflow
+            rebuild(capacity, 2 * width);
+            increment(x);
+            return;
+        }
+        setCounter(i, value);
+    }
+
+    // moves the entries to a table of (newCapacity) slots and counters of (newWidth) bytes
+    void rebuild(const uint32_t newCapacity, const uint32_t newWidth) {
+        acTable table;
+        table.capacity = newCapacity;
+        table.width = newWidth;
+        table.keys = (uint32_t *) new uint8_t[(uint64_t) newCapacity * (sizeof(uint32_t) + newWidth)];
+        std::fill(table.keys, table.keys + newCapacity, AC_EMPTY);
+        std::fill(table.counters(), table.counters() + (uint64_t) newCapacity * newWidth, 0);
+        for (uint32_t i = 0; i < capacity; ++i) {
+            if (keys[i] != AC_EMPTY) {
+                const uint32_t j = table.probe(keys[i]);
+                table.keys[j] = keys[i];
+                table.setCounter(j, counter(i));
+                ++table.size;
+            }
+        }
+        *this = std::move(table);
+    }
+};
+
+/*
+|N(a) and N(c)| of one a for the cs of the current partition, as flat arrays sorted by c: the 
+keys are followed by their counters of (width) bytes in one allocation, as in acTable
+A list is built once from the acTable of its a and then only trimmed, by moving (start) past 
+the cs of the earlier partitions; it is compacted when more than half of it is skipped
+*/
+struct acList {
+    uint32_t *keys = NULL;
+    uint32_t start = 0;
+    uint32_t size = 0;
+    uint32_t width = 1;
+
+    acList() = default;
+    acList(const acList&) = delete;
+    acList& operator=(const acList&) = delete;
+    acList(acList&& other) {*this = std::move(other);}
+    acList& operator=(acList&& other) {
+        std::swap(keys, other.keys);
+        std::swap(start, other.start);
+        std::swap(size, other.size);
+        std::swap(width, other.width);
+        return *this;
+    }
+    ~acList() {delete[] (uint8_t *) keys;}
+
+    uint8_t *counters() const {return (uint8_t *) (keys + size);}
+
+    uint32_t counter(const uint32_t i) const {
+        if (width == 1) return counters()[i];
+        if (width == 2) return ((uint16_t *) counters())[i];
+        return ((uint32_t *) counters())[i];
+    }
+
+    void allocate(const uint32_t newSize, const uint32_t newWidth) {
+        *this = acList();
+        size = newSize;
+        width = newWidth;
+        keys = (uint32_t *) new uint8_t[(uint64_t) newSize * (sizeof(uint32_t) + newWidth)];
+    }
+
+    void setCounter(const uint32_t i, const uint32_t value) {
+        if (width == 1) counters()[i] = value;
+        else if (width == 2) ((uint16_t *) counters())[i] = value;
+        else ((uint32_t *) counters())[i] = value;
+    }
+
+    // the entries of (table) in order, with counters just wide enough for the largest
+    void assign(const acTable& table) {
+        std::vector<std::pair<uint32_t, uint32_t>> entries;
+        entries.reserve(table.size);
+        uint32_t most = 0;
+        table.forEach([&](const uint32_t x, const uint32_t count) {
+            entries.emplace_back(x, count);
+            most = std::max(most, count);
+        });
+        std::sort(entries.begin(), entries.end());
+        allocate(entries.size(), most >> 16 != 0 ? 4 : most >> 8 != 0 ? 2 : 1);
+        for (uint32_t i = 0; i < size; ++i) {
+            keys[i] = entries[i].first;
+            setCounter(i, entries[i].second);
+        }
+    }
+
+    // the first index from (from) whose key is not below x, by doubling steps and then a binary search
+    uint32_t lowerBound(const uint32_t x, uint32_t from) const {
+        uint32_t step = 1;
+        while (from + step < size && keys[from + step] < x) {
+            from += step;
+            step *= 2;
+        }
+        return std::lower_bound(keys + from, keys + std::min(from + step, size), x) - keys;
+    }
+
+    // skips the keys below (first), which must not be below those already skipped
+    void eraseBelow(const uint32_t first) {
+        start = lowerBound(first, start);
+        if (start == size) {
+            *this = acList();
+        }
+        else if (2 * start > size) {
+            acList list;
+            list.allocate(size - start, width);
+            std::copy(keys + start, keys + size, list.keys);
+            std::copy(counters() + (uint64_t) start * width, counters() + (uint64_t) size * width, list.counters());
+            *this = std::move(list);
+        }
+    }
+};
+
+/*
+Local IDs of the left set nodes two hops from the current b, indexed by node
+When the scratch of a thread would not be smaller than vLeft entries, the ID of x is ids[x]; 
+otherwise x is kept in a linear probing table of at least twice the two-hop bound. Erasing 
+only clears the ID and leaves the key, so the probes of the other nodes erased after the same b 
+still reach them; later inserts reuse every slot whose ID is 0
+*/
+struct localIndex {
+    hugeVector<uint32_t> keys;
+    hugeVector<uint32_t> ids;
+    uint32_t mask;
+    bool dense;
+
+    localIndex(const uint32_t bound, const uint32_t vLeft) {
+        uint64_t capacity = 1;
+        while (capacity < 2 * (uint64_t) bound) {
+            capacity *= 2;
+        }
+        dense = vLeft <= 2 * capacity;
+        if (dense) {
+            ids.resize(vLeft);
+        }
+        else {
+            keys.resize(capacity);
+            ids.resize(capacity);
+            mask = capacity - 1;
+        }
+    }
+
+    // the ID of x, 0 if x has none yet; a new ID is stored through the reference
+    uint32_t& operator[](const uint32_t x) {
+        if (dense) {
+            return ids[x];
+        }
+        uint32_t h = (x * 2654435761u) & mask;
+        while (ids[h] != 0 && keys[h] != x) {
+            h = (h + 1) & mask;
+        }
+        keys[h] = x;
+        return ids[h];
+    }
+
+    // the ID of x, 0 if x has none; unlike operator[], nothing is stored
+    uint32_t find(const uint32_t x) const {
+        if (dense) {
+            return ids[x];
+        }
+        uint32_t h = (x * 2654435761u) & mask;
+        while (ids[h] != 0) {
+            if (keys[h] == x) {
+                return ids[h];
+            }
+            h = (h + 1) & mask;
+        }
+        return 0;
+    }
+
+    // removes the ID of x, which must have one
+    void erase(const uint32_t x) {
+        if (dense) {
+            ids[x] = 0;
+            return;
+        }
+        uint32_t h = (x * 2654435761u) & mask;
+        while (keys[h] != x) {
+            h = (h + 1) & mask;
+        }
+        ids[h] = 0;
+    }
+};
+
+/*
+Scratch of one thread in the b loop, for at most (bound) left set nodes on each side of b: 
+the wedge counts and list ends of the as in [0, bound) and of the cs in [bound, 2 * bound)
+The wedge lists of one b are placed back to back in (wedges) by a counting sort: (slots) 
+records the list of every wedge as they are counted, and the fill pass replays it. Both grow 
+to the most wedges of any b so far and are reused for every later b
+(sortedCs) holds the cs of b by node, each with its local ID in the low 32 bits, and (triples) 
+the common neighbor counts of the marker kernel, numCs per a
+(pairs) and (probes) count the (a, c) pairs of all bs and the lookups made to join them, and 
+(markers) the bs whose triples the marker kernel counted
+*/
+struct btjScratch {
+    hugeVector<uint32_t> ABCs_counts;
+    hugeVector<uint64_t> ABCs_ends;
+    localIndex localIDs;
+    hugeVector<uint32_t> reverseIDs;
+    hugeVector<uint64_t> sortedCs;
+    hugeVector<uint32_t> triples;
+    hugeVector<uint32_t> slots;
+    hugeVector<uint32_t> wedges;
+    uint64_t pairs = 0;
+    uint64_t probes = 0;
+    uint64_t markers = 0;
+
+    btjScratch(const uint32_t bound, const uint32_t vLeft) : ABCs_counts(2 * (uint64_t) bound), ABCs_ends(2 * (uint64_t) bound), 
+                                                             localIDs(bound, vLeft), reverseIDs(2 * (uint64_t) bound), 
+                                                             sortedCs(bound) {}
+
+    // makes room for (n) wedges; the old contents are not kept
+    void reserve(const uint64_t n) {
+        if (slots.size() < n) {
+            slots = hugeVector<uint32_t>(n);
+            wedges = hugeVector<uint32_t>(n);
+        }
+    }
+
+    // makes room for (n) counters of the marker kernel; the old contents are not kept
+    void reserveTriples(const uint64_t n) {
+        if (triples.size() < n) {
+            triples = hugeVector<uint32_t>(n);
+        }
+    }
+};
+
+// the most counters (4 bytes each) of the marker kernel table of a thread; bs with more (a, c) pairs always intersect
+const uint64_t TRIPLES_TABLE_LIMIT = 1 << 22;
+
+// costs of one count of the marker kernel and of the lookups around one intersection of the 
+// pair kernel, in list values intersected
+const uint64_t MARKER_COST = 1;
+const uint64_t PAIR_COST = 8;
+
+// in NUMA partition mode, moves the rows of the bs [first, last) to the memory of the node that counts them
+void placeRows(const graph& G, const uint32_t first, const uint32_t last, const uint32_t node) {
+    placeOnNode(G.neighbors.data() + G.offsets[first], G.neighbors.data() + G.offsets[last], node);
+    placeOnNode(G.splits.data() + G.offsets[first], G.splits.data() + G.offsets[last], node);
 }
 
-// returns number of induced 6 cycles
-uint64_t getCount(const graph& G, const uint32_t vLeft, const uint32_t partition_size) {
+void placeRows(const compressedGraph& C, const uint32_t first, const uint32_t last, const uint32_t node) {
+    placeOnNode(C.bytes.data() + C.offsets[first], C.bytes.data() + C.offsets[last], node);
+}
+
+/*
+returns number of induced 6 cycles
+(G) is a graph or a compressedGraph, whose neighbor lists are decoded into per-range buffers
+Only the hub bitmaps of (E) are used
+*/
+template <typename Graph>
+uint64_t getCount(const Graph& G, const uint32_t vLeft, const uint32_t partition_size, const edges& E, const uint32_t bound) {
     
     // initial bounds
     uint32_t a_end = std::min(partition_size - 1, vLeft - 3);
@@ -54,125 +387,252 @@ uint64_t getCount(const graph& G, const uint32_t vLeft, const uint32_t partition
 
     uint32_t c_start = 2;
 
-    std::vector<phmap::flat_hash_map<uint32_t, uint32_t>> ACs(vLeft - 2);
+    std::vector<acList> ACs(vLeft - 2);
 
     std::vector<uint64_t> counts(vLeft - 2);
 
+    // a hub's bitmap counts every duplicate edge in AB or BC, while the merge counts each once 
+    // per match, so hub bitmaps are only used when duplicate edges are dropped
+    const bool hubs = normalizing();
+
     int num_threads = tbb::this_task_arena::max_concurrency();
 
     std::cout << "Operating on " << num_threads << " threads" << std::endl;
 
-    std::vector<std::vector<uint32_t>> ABCs(num_threads * vLeft);
+    if (verbose()) {
+        std::cout << "Intersecting with " << INTERSECTION.name << " kernels" << std::endl;
+    }
 
-    std::vector<uint32_t> ABCs_counts(num_threads * vLeft);
+    // the marker kernel counts every u once per a and c it joins, which differs from the 
+    // intersections when duplicate edges are kept
+    const uint32_t triples = normalizing() ? triplesMode() : TRIPLES_PAIRS;
 
-    std::vector<uint32_t> localIDs(num_threads * vLeft);
+    const bool placing = numaMode() == NUMA_PARTITION;
 
-    std::vector<uint32_t> reverseIDs(num_threads * vLeft);
+    // the scratch of every thread holds the two-hop neighborhood of one b, not all of the left set
+    tbb::enumerable_thread_specific<btjScratch> scratch([&] {return btjScratch(bound, vLeft);});
 
     while (b_start <= vLeft - 2) {
 
         tbb::parallel_for(tbb::blocked_range<uint32_t>(0, a_end + 1), [&](tbb::blocked_range<uint32_t> r) {
+            std::vector<uint32_t> rowBuffer, neighborBuffer;
             for (uint32_t a = r.begin(); a < r.end(); ++a) {
                 if (a < b_start - 1) {
                     // update existing a
-                    phmap::flat_hash_map<uint32_t, uint32_t>& S = ACs[a];
-                    for (phmap::flat_hash_map<uint32_t, uint32_t>::iterator it = S.begin(); it != S.end();) {
-                        if ((it->first) < c_start) {
-                            it = S.erase(it);
-                        }
-                        else {
-                            ++it;
-                        }
-                    }
+                    ACs[a].eraseBelow(c_start);
                 }
                 else {
-                    for (uint32_t u : G[a]) {
-                        for (uint32_t c : G[u]) {
-                            if (c > a && c >= c_start) {
-                                ACs[a][c] += 1;
-                            }
-                            else {
-                                break;
-                            }
+                    acTable table;
+                    const neighborSpan<const uint32_t> A = G.row(a, rowBuffer);
+                    for (uint64_t i = 0; i < A.size(); ++i) {
+                        neighborSpan<const uint32_t> Cs = G.higher(a, i, A[i], neighborBuffer);
+                        // c_start = b_start + 1, so only a = b_start - 1 has higher neighbors below c_start
+                        if (c_start > a + 1) {
+                            Cs.last = std::partition_point(Cs.begin(), Cs.end(), [c_start](uint32_t c) {return c >= c_start;});
+                        }
+                        for (uint32_t c : Cs) {
+                            table.increment(c);
                         }
                     }
+                    ACs[a].assign(table);
                 }
             }
         });
 
-        tbb::parallel_for(tbb::blocked_range<uint32_t>(b_start, b_end + 1), [&](tbb::blocked_range<uint32_t> r) {
-            for (uint32_t b = r.begin(); b < r.end(); ++b) {
-
-                int pid = tbb::task_arena::current_thread_index();
-                const uint32_t globalStart = pid * vLeft;
-
-                const uint32_t max = (pid + 1) * vLeft;
-
-                uint32_t numAs = 0;
-                uint32_t numCs = 0;
-
-                for (uint32_t u : G[b]) {
-                    for (uint32_t c : G[u]) {
-                        if (c > b) {
-                            if (localIDs[globalStart + c] == 0) {
+        forEachNode(b_start, b_end + 1, [&](uint32_t b) {return G.degree(b);}, [&](uint32_t node, uint32_t first, uint32_t last) {
+            // every b is in one partition, so its row is moved once, to the node that counts it
+            if (placing) {
+                placeRows(G, first, last, node);
+            }
+            tbb::parallel_for(tbb::blocked_range<uint32_t>(first, last), [&](tbb::blocked_range<uint32_t> r) {
+                // allocated by the thread on its first use, so in NUMA mode it is placed on the thread's node
+                btjScratch& local = scratch.local();
+                hugeVector<uint32_t>& ABCs_counts = local.ABCs_counts;
+                hugeVector<uint64_t>& ABCs_ends = local.ABCs_ends;
+                localIndex& localIDs = local.localIDs;
+                hugeVector<uint32_t>& reverseIDs = local.reverseIDs;
+                uint64_t *sortedCs = local.sortedCs.data();
+                std::vector<uint32_t> rowBuffer, neighborBuffer;
+                std::vector<uint64_t> wedgeEnds, csEnds;
+                for (uint32_t b = r.begin(); b < r.end(); ++b) {
+
+                    uint32_t numAs = 0;
+                    uint32_t numCs = 0;
+
+                    const neighborSpan<const uint32_t> B = G.row(b, rowBuffer);
+
+                    // every other neighbor of every u in N(b) is at most one wedge
+                    uint64_t numWedges = 0;
+                    for (uint32_t u : B) {
+                        numWedges += G.degree(u) - 1;
+                    }
+                    local.reserve(numWedges);
+                    uint32_t *slots = local.slots.data();
+                    uint32_t *wedges = local.wedges.data();
+                    wedgeEnds.resize(B.size());
+                    csEnds.resize(B.size());
+
+                    // count pass: the list (slot) of every wedge, in the order the wedges are found, 
+                    // the cs of each u before its as; (markerCounts) are the (a, c) pairs of all us
+                    uint64_t w = 0;
+                    uint64_t markerCounts = 0;
+                    for (uint64_t i = 0; i < B.size(); ++i) {
+                        const uint32_t u = B[i];
+                        neighborSpan<const uint32_t> Cs, As;
+                        G.split(b, i, u, neighborBuffer, Cs, As);
+                        for (uint32_t c : Cs) {
+                            uint32_t& localId = localIDs[c];
+                            if (localId == 0) {
                                 ++numCs;
-                                localIDs[globalStart + c] = numCs;
-                                reverseIDs[globalStart + b + numCs - 1] = c;
+                                localId = numCs;
+                                reverseIDs[bound + numCs - 1] = c;
                             }
-                            const uint32_t localId = localIDs[globalStart + c];
-                            ABCs[globalStart + b + localId - 1].emplace_back(u);
-                            ABCs_counts[globalStart + b + localId - 1] += 1;
+                            slots[w++] = bound + localId - 1;
+                            ABCs_counts[bound + localId - 1] += 1;
                         }
+                        csEnds[i] = w;
                         // c = a
-                        else if (b > c) {
-                            if (localIDs[globalStart + c] == 0) {
+                        for (uint32_t c : As) {
+                            uint32_t& localId = localIDs[c];
+                            if (localId == 0) {
                                 ++numAs;
-                                localIDs[globalStart + c] = numAs;
-                                reverseIDs[globalStart + numAs - 1] = c;
+                                localId = numAs;
+                                reverseIDs[numAs - 1] = c;
                             }
-                            const uint32_t localId = localIDs[globalStart + c];
-                            ABCs[globalStart + localId - 1].emplace_back(u);
-                            ABCs_counts[globalStart + localId - 1] += 1;
+                            slots[w++] = localId - 1;
+                            ABCs_counts[localId - 1] += 1;
                         }
+                        wedgeEnds[i] = w;
+                        markerCounts += (csEnds[i] - (i == 0 ? 0 : wedgeEnds[i - 1])) * (w - csEnds[i]);
                     }
-                }
 
-                #pragma omp simd
-                for (uint32_t a = 0; a < numAs; ++a) {
-                    const uint32_t origA = reverseIDs[globalStart + a];
-                    phmap::flat_hash_map<uint32_t, uint32_t>& S = ACs.at(origA);
-                    const std::vector<uint32_t>& AB = ABCs[globalStart + a];
-                    const uint32_t ab_val = ABCs_counts[globalStart + a];
-                    for (uint32_t c = 0; c < numCs; ++c) {
-                        const uint32_t origC = reverseIDs[globalStart + b + c];
-                        const auto iter = S.find(origC);
-                        if (iter != S.end()) {
-                            const uint32_t ac_val = iter->second;
+                    // prefix sum: the lists of the as, then those of the cs, are laid out back to back
+                    uint64_t start = 0;
+                    for (uint32_t a = 0; a < numAs; ++a) {
+                        ABCs_ends[a] = start;
+                        start += ABCs_counts[a];
+                    }
+                    const uint64_t cWedges = w - start;
+                    for (uint32_t c = bound; c < bound + numCs; ++c) {
+                        ABCs_ends[c] = start;
+                        start += ABCs_counts[c];
+                    }
+
+                    // fill pass: u is appended to the list of each of its wedges, so every list stays in descending order
+                    w = 0;
+                    for (uint64_t i = 0; i < B.size(); ++i) {
+                        for (const uint32_t u = B[i]; w < wedgeEnds[i]; ++w) {
+                            wedges[ABCs_ends[slots[w]]++] = u;
+                        }
+                    }
 
-                            const std::vector<uint32_t>& BC = ABCs[globalStart + b + c];
+                    /*
+                    The marker kernel counts |N(a) and N(b) and N(c)| of all pairs at once in a table of 
+                    numCs counters per a: each u in N(b) adds one to the counter of every a and c it has 
+                    as neighbors. Otherwise, a pair is intersected when the join finds it; there are at 
+                    most as many as the cs of a or of b, and the intersection is about as long as the 
+                    list of a and that of an average c
+                    */
+                    const uint64_t tableSize = (uint64_t) numAs * numCs;
+                    bool marker = false;
+                    if (triples != TRIPLES_PAIRS && tableSize <= TRIPLES_TABLE_LIMIT && numCs != 0) {
+                        marker = triples == TRIPLES_MARKER;
+                        if (!marker) {
+                            uint64_t pairCost = 0;
+                            for (uint32_t a = 0; a < numAs; ++a) {
+                                const acList& S = ACs[reverseIDs[a]];
+                                pairCost += std::min(S.size - S.start, numCs) * (PAIR_COST + ABCs_counts[a] + cWedges / numCs);
+                            }
+                            marker = MARKER_COST * markerCounts + tableSize / 16 < pairCost;
+                        }
+                    }
+                    uint32_t *markerTable = NULL;
+                    if (marker) {
+                        local.reserveTriples(tableSize);
+                        markerTable = local.triples.data();
+                        std::fill(markerTable, markerTable + tableSize, 0);
+                        for (uint64_t i = 0; i < B.size(); ++i) {
+                            for (uint64_t x = csEnds[i]; x < wedgeEnds[i]; ++x) {
+                                uint32_t *row = markerTable + (uint64_t) slots[x] * numCs;
+                                for (uint64_t y = i == 0 ? 0 : wedgeEnds[i - 1]; y < csEnds[i]; ++y) {
+                                    ++row[slots[y] - bound];
+                                }
+                            }
+                        }
+                        ++local.markers;
+                    }
+
+                    // sorted by the first a that joins from the cs of b
+                    bool sorted = false;
+
+                    for (uint32_t a = 0; a < numAs; ++a) {
+                        const uint32_t origA = reverseIDs[a];
+                        const acList& S = ACs.at(origA);
+                        const uint32_t ab_val = ABCs_counts[a];
+                        const neighborSpan<const uint32_t> AB = {wedges + ABCs_ends[a] - ab_val, wedges + ABCs_ends[a]};
+                        const uint64_t *aHub = hubs ? E.bitmap(origA) : NULL;
+
+                        // adds the cycles through a, b and the c of local ID (c), given ac_val = |N(a) and N(c)| > 0
+                        auto countCycles = [&](const uint32_t c, const uint32_t ac_val) {
+                            const uint32_t origC = reverseIDs[bound + c];
+                            const uint32_t bc_val = ABCs_counts[bound + c];
 
-                            const uint32_t bc_val = ABCs_counts[globalStart + b + c];
+                            const neighborSpan<const uint32_t> BC = {wedges + ABCs_ends[bound + c] - bc_val, wedges + ABCs_ends[bound + c]};
 
                             // notin = |N(a) and N(b) and N(c)|
-                            const uint32_t notin = intersection_size(AB, BC);
+                            // AB holds all of N(a) and N(b) and BC all of N(b) and N(c), so a hub's bitmap tells membership in AB or BC
+                            const uint32_t notin = marker ? markerTable[(uint64_t) a * numCs + c] : 
+                                                   intersectionSize(AB.data(), ab_val, aHub, BC.data(), bc_val, hubs ? E.bitmap(origC) : NULL, vLeft);
 
                             counts[b - 1] += ((uint64_t) ab_val - notin) * (ac_val - notin) * (bc_val - notin);
+                        };
+
+                        // join the cs of b, which are all above b, with those of a from the smaller side: 
+                        // the entries of a above b are looked up among the local IDs, where those above 
+                        // b are cs, or the cs of b are searched for in order in the entries of a
+                        const uint32_t first = S.lowerBound(b + 1, S.start);
+                        if (S.size - first < numCs) {
+                            for (uint32_t i = first; i < S.size; ++i) {
+                                const uint32_t localId = localIDs.find(S.keys[i]);
+                                if (localId != 0) {
+                                    countCycles(localId - 1, S.counter(i));
+                                }
+                            }
+                            local.probes += S.size - first;
+                        }
+                        else {
+                            if (!sorted) {
+                                for (uint32_t c = 0; c < numCs; ++c) {
+                                    sortedCs[c] = (uint64_t) reverseIDs[bound + c] << 32 | c;
+                                }
+                                std::sort(sortedCs, sortedCs + numCs);
+                                sorted = true;
+                            }
+                            uint32_t i = first;
+                            for (uint32_t c = 0; c < numCs && i < S.size; ++c) {
+                                i = S.lowerBound(sortedCs[c] >> 32, i);
+                                if (i < S.size && S.keys[i] == sortedCs[c] >> 32) {
+                                    countCycles((uint32_t) sortedCs[c], S.counter(i));
+                                }
+                            }
+                            local.probes += numCs;
                         }
+                        ABCs_counts[a] = 0;
                     }
-                    ABCs[globalStart + a].clear();
-                    ABCs_counts[globalStart + a] = 0;
-                    localIDs[globalStart + origA] = 0;
-                }
+                    local.pairs += (uint64_t) numAs * numCs;
 
-                #pragma omp simd
-                for (uint32_t c = 0; c < numCs; ++c) {
-                    ABCs[globalStart + b + c].clear();
-                    ABCs_counts[globalStart + b + c] = 0;
-                    localIDs[globalStart + reverseIDs[globalStart + b + c]] = 0;
-                }
+                    // the IDs are only erased now, as an erased ID ends the probes of localIDs.find
+                    for (uint32_t a = 0; a < numAs; ++a) {
+                        localIDs.erase(reverseIDs[a]);
+                    }
 
-            }
+                    for (uint32_t c = 0; c < numCs; ++c) {
+                        ABCs_counts[bound + c] = 0;
+                        localIDs.erase(reverseIDs[bound + c]);
+                    }
+
+                }
+            });
         });
 
         // update bounds
@@ -182,6 +642,17 @@ uint64_t getCount(const graph& G, const uint32_t vLeft, const uint32_t partition
         c_start = b_start + 1;
     }
     
+    uint64_t pairs = 0, probes = 0, markers = 0;
+    for (const btjScratch& local : scratch) {
+        pairs += local.pairs;
+        probes += local.probes;
+        markers += local.markers;
+    }
+    if (verbose()) {
+        std::cout << "Joined " << pairs << " (a, c) pairs with " << probes << " lookups, " << pairs - probes << " saved" << std::endl;
+        std::cout << "Counted the common neighbors of " << markers << " bs with the marker kernel" << std::endl;
+    }
+
     // sum over all left set nodes' associated induced 6-cycle counts to obtain total induced 6-cycle count
     Sum total;
     tbb::parallel_reduce(tbb::blocked_range<std::vector<uint64_t>::iterator>(counts.begin(), counts.end()), total);
@@ -198,7 +669,8 @@ int main(int argc, char *argv[]) {
 
     char *filename = argv[1];
 
-    uint32_t nEdge, vLeft, vRight;
+    uint64_t nEdge;
+    uint32_t vLeft, vRight;
 
     long long int partition_size;
 
@@ -211,7 +683,14 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    graph G = readGraph(filename, nEdge, vLeft, vRight);
+    graph G;
+
+    // a cached graph has already been preprocessed
+    const bool cached = readCache(filename, G, nEdge, vLeft, vRight);
+
+    if (!cached) {
+        G = readGraph(filename, nEdge, vLeft, vRight);
+    }
 
     if (argc == 2) {
         partition_size = vLeft;
@@ -219,15 +698,38 @@ int main(int argc, char *argv[]) {
 
     auto start = get_time();
     
-    preProcessing(G, vLeft, vRight);
+    if (!cached) {
+        std::vector<uint32_t> newID;
+        preProcessing(G, vLeft, vRight, newID);
+        writeCache(filename, G, nEdge, vLeft, vRight);
+    }
 
     std::cout << "New vLeft: " << vLeft << "; new vRight: " << vRight << std::endl;
 
+    tuneIntersections(vRight);
+
     if (vLeft < 3 || vRight < 3) {
         std::cout << "Number of induced 6 cycles: 0" << "\n";
     }
+    else if (compressing()) {
+        const uint32_t bound = twoHopBound(G, vLeft);
+        edges E;
+        buildEdges(G, vLeft, E);
+        const uint64_t uncompressed = G.neighbors.size() * sizeof(uint32_t);
+        // the uncompressed rows are released as they are encoded; only the hub bitmaps of E are used
+        const compressedGraph C = compressGraph(G);
+        E.neighbors = NULL;
+        if (verbose()) {
+            std::cout << "Compressed neighbors from " << uncompressed << " to " << C.bytes.size() << " bytes" << std::endl;
+        }
+        uint64_t c = getCount(C, vLeft, partition_size, E, bound);
+        std::cout << "Number of induced 6 cycles: " << c << "\n";
+    }
     else {
-        uint64_t c = getCount(G, vLeft, partition_size);
+        edges E;
+        buildEdges(G, vLeft, E);
+        orientGraph(G, vLeft);
+        uint64_t c = getCount(G, vLeft, partition_size, E, twoHopBound(G, vLeft));
         std::cout << "Number of induced 6 cycles: " << c << "\n";
     }
 
@@ -2,7 +2,7 @@
     Prints the induced 6-cycle count of simple bipartite graphs
 
     To run:
-        g++ -o NJ NJ.cpp preProcessing.cpp utilities.cpp -std=c++17 -O3 -fopenmp -ltbb
+        g++ -o NJ NJ.cpp preProcessing.cpp intersect.cpp compress.cpp utilities.cpp -std=c++17 -O3 -fopenmp -ltbb -lz
         ./NJ path_to_dataset
     
     Dataset format:
@@ -36,34 +36,22 @@ uint64_t getCount(const graph& G, const uint32_t vLeft, const edges& E) {
                     std::vector<uint32_t> AB;
                     AB.reserve(G[a].size());
                     // N(A) \ N(b)
-                    for (uint32_t v : G[a]) {
-                        if (v == u)
-                            break;
+                    for (uint32_t v : G.higher(u, i)) {
                         if (!E[v].contains(b)) {
                             AB.emplace_back(v);
                         }
                     }
-                    for (uint32_t w : G[b]) {
-                        if (w == u)
-                            break;
+                    for (uint32_t w : G.higher(u, i2)) {
                         if (!E[w].contains(a)) {
                             uint32_t w_size = G[w].size();
                             for (uint32_t v : AB) {
                                 uint64_t vw = ((uint64_t) v + w) * (v + w + 1) / 2 + std::min(v, w);
                                 if (!VWs.contains(vw)) {
                                     uint64_t count = 0;
-                                    if (G[v].size() < w_size)
-                                        for (uint32_t c : G[v]) {
-                                            if (E[w].contains(c) && !E[u].contains(c)) {
-                                                ++count;
-                                            }
-                                        }
-                                    else
-                                        for (uint32_t c : G[w]) {
-                                            if (E[v].contains(c) && !E[u].contains(c)) {
-                                                ++count;
-                                            }
-                                        }
+                                    // common neighbors of v and w that are not neighbors of u
+                                    forEachCommon(G[v].data(), G[v].size(), E.bitmap(v), G[w].data(), w_size, E.bitmap(w), vLeft, [&](uint32_t c) {
+                                        count += !E[u].contains(c);
+                                    });
                                     VWs[vw] = count;
                                     counts[u] += count;
                                 }
@@ -94,15 +82,31 @@ int main(int argc, char *argv[]) {
 
     char *filename = argv[1];
 
-    uint32_t nEdge, vLeft, vRight;
+    uint64_t nEdge;
+    uint32_t vLeft, vRight;
 
-    graph G = readGraph(filename, nEdge, vLeft, vRight);
+    graph G;
+
+    // a cached graph has already been preprocessed
+    const bool cached = readCache(filename, G, nEdge, vLeft, vRight);
+
+    if (!cached) {
+        G = readGraph(filename, nEdge, vLeft, vRight);
+    }
 
     edges E;
 
     auto start = get_time();
 
-    preProcessing(G, vLeft, vRight, E);
+    if (!cached) {
+        std::vector<uint32_t> newID;
+        preProcessing(G, vLeft, vRight, newID);
+        writeCache(filename, G, nEdge, vLeft, vRight);
+    }
+
+    buildEdges(G, vLeft, E);
+    orientGraph(G, vLeft);
+    tuneIntersections(vRight);
 
     uint64_t c = getCount(G, vLeft, E);
     
@@ -2,7 +2,7 @@
     Prints the induced 6-cycle count of simple bipartite graphs
 
     To run:
-        g++ -o TJ TJ.cpp preProcessing.cpp utilities.cpp -std=c++17 -O3 -fopenmp -ltbb
+        g++ -o TJ TJ.cpp preProcessing.cpp intersect.cpp compress.cpp utilities.cpp -std=c++17 -O3 -fopenmp -ltbb -lz
         ./TJ path_to_dataset
     
     Dataset format:
@@ -20,14 +20,16 @@
 
 #include "main.h"
 
+// |AB \ N(c)|, the nodes of AB that are not neighbors of c
 uint64_t ab_c(const edges& E, const std::vector<uint32_t>& AB, const uint32_t c) {
-    uint64_t count = 0;
-    for (uint32_t x : AB) {
-        if (!E[c].contains(x)) {
-            ++count;
-        }
+    const edgeRow row = E[c];
+    if (!DISTINCT_NEIGHBORS) {
+        // with duplicate edges kept, every copy of a node in AB is tested
+        uint64_t common = 0;
+        probeCommon(AB.data(), AB.size(), row.first, row.size, row.bitmap, row.base, [&](uint32_t) {++common;});
+        return AB.size() - common;
     }
-    return count;
+    return AB.size() - intersectionSize(AB.data(), AB.size(), NULL, row.first, row.size, row.bitmap, row.base);
 }
 
 // returns number of induced 6 cycles
@@ -36,14 +38,10 @@ uint64_t getCount(const graph& G, const uint32_t vLeft, const edges& E) {
     std::vector<phmap::flat_hash_map<uint32_t, std::vector<uint32_t>>> ABs(vLeft - 1);
     tbb::parallel_for(tbb::blocked_range<uint32_t>(0, vLeft - 1), [&](tbb::blocked_range<uint32_t> r) {
         for (uint32_t a = r.begin(); a < r.end(); ++a) {
-            for (uint32_t u : G[a]) {
-                for (uint32_t b : G[u]) {
-                    if (b > a) {
-                        ABs[a][b].emplace_back(u);
-                    }
-                    else {
-                        break;
-                    }
+            for (uint64_t i = 0; i < G[a].size(); ++i) {
+                const uint32_t u = G[a][i];
+                for (uint32_t b : G.higher(a, i)) {
+                    ABs[a][b].emplace_back(u);
                 }
             }
         }
@@ -55,12 +53,9 @@ uint64_t getCount(const graph& G, const uint32_t vLeft, const edges& E) {
     tbb::parallel_for(tbb::blocked_range<uint32_t>(0, vLeft - 2), [&](tbb::blocked_range<uint32_t> r) {
         for (uint32_t a = r.begin(); a < r.end(); ++a) {
             phmap::flat_hash_set<uint32_t> S;
-            for (uint32_t v : G[a])
-                for (uint32_t b : G[v])
-                    if (b > a)
-                        S.emplace(b);
-                    else
-                        break;
+            for (uint64_t i = 0; i < G[a].size(); ++i)
+                for (uint32_t b : G.higher(a, i))
+                    S.emplace(b);
                 
             for (uint32_t b : S)
                 for (uint32_t c : S)
@@ -88,15 +83,31 @@ int main(int argc, char *argv[]) {
 
     char *filename = argv[1];
 
-    uint32_t nEdge, vLeft, vRight;
+    uint64_t nEdge;
+    uint32_t vLeft, vRight;
+
+    graph G;
 
-    graph G = readGraph(filename, nEdge, vLeft, vRight);
+    // a cached graph has already been preprocessed
+    const bool cached = readCache(filename, G, nEdge, vLeft, vRight);
+
+    if (!cached) {
+        G = readGraph(filename, nEdge, vLeft, vRight);
+    }
 
     edges E;
 
     auto start = get_time();
 
-    preProcessing(G, vLeft, vRight, E);
+    if (!cached) {
+        std::vector<uint32_t> newID;
+        preProcessing(G, vLeft, vRight, newID);
+        writeCache(filename, G, nEdge, vLeft, vRight);
+    }
+
+    buildEdges(G, vLeft, E);
+    orientGraph(G, vLeft);
+    tuneIntersections(vRight);
 
     uint64_t c = getCount(G, vLeft, E);
     
@@ -2,7 +2,7 @@
     Prints the induced 6-cycle count of simple bipartite graphs
 
     To run:
-        g++ -o WJ WJ.cpp preProcessing.cpp utilities.cpp -std=c++17 -O3 -fopenmp -ltbb
+        g++ -o WJ WJ.cpp preProcessing.cpp intersect.cpp compress.cpp utilities.cpp -std=c++17 -O3 -fopenmp -ltbb -lz
         ./WJ path_to_dataset
     
     Dataset format:
@@ -41,19 +41,15 @@ bool getm (const std::vector<std::tuple<uint32_t, uint32_t, uint32_t>>& Wedges,
 }
 
 // returns number of induced 6 cycles
-uint64_t getCount(const graph& G, const uint32_t nEdge, const uint32_t vLeft, const edges& E) {
+uint64_t getCount(const graph& G, const uint64_t nEdge, const uint32_t vLeft, const edges& E) {
 
     // assign wedge partitions to each node in U
     std::vector<uint64_t> partitions(vLeft);
     tbb::parallel_for(tbb::blocked_range<uint32_t>(0, vLeft - 1), [&](tbb::blocked_range<uint32_t> r) {
         for (uint32_t u = r.begin(); u < r.end(); ++u) {
             uint64_t val = 0;
-            for (uint32_t v : G[u]) {
-                for (uint32_t u2 : G[v]) {
-                    if (u2 > u) {
-                        ++val;
-                    }
-                }
+            for (uint64_t i = 0; i < G[u].size(); ++i) {
+                val += G.higher(u, i).size();
             }
             partitions[u + 1] = val;
         }
@@ -79,26 +75,25 @@ uint64_t getCount(const graph& G, const uint32_t nEdge, const uint32_t vLeft, co
     tbb::parallel_for(tbb::blocked_range<uint32_t>(0, vLeft - 1), [&](tbb::blocked_range<uint32_t> r) {
         for (uint32_t u1 = r.begin(); u1 < r.end(); ++u1) {
             uint64_t i = 0;
-            for (uint32_t v1 : G[u1])
-                for (uint32_t u2 : G[v1])
-                    if (u2 > u1) {
-                        for (uint64_t w = partitions[u1]; w < partitions[u1] + i + 1; ++w) {
-                            if (w == partitions[u1] + i) {
-                                Wedges[w] = std::make_tuple(u1, u2, v1);
-                                break;
-                            }
-                            if (u2 < std::get<1>(Wedges[w])) {
-                                for (uint64_t w2 = partitions[u1] + i; w2 >= w + 1; --w2) {
-                                    Wedges[w2] = Wedges[w2 - 1];
-                                }
-                                Wedges[w] = std::make_tuple(u1, u2, v1);
-                                break;
+            for (uint64_t j = 0; j < G[u1].size(); ++j) {
+                const uint32_t v1 = G[u1][j];
+                for (uint32_t u2 : G.higher(u1, j)) {
+                    for (uint64_t w = partitions[u1]; w < partitions[u1] + i + 1; ++w) {
+                        if (w == partitions[u1] + i) {
+                            Wedges[w] = std::make_tuple(u1, u2, v1);
+                            break;
+                        }
+                        if (u2 < std::get<1>(Wedges[w])) {
+                            for (uint64_t w2 = partitions[u1] + i; w2 >= w + 1; --w2) {
+                                Wedges[w2] = Wedges[w2 - 1];
                             }
+                            Wedges[w] = std::make_tuple(u1, u2, v1);
+                            break;
                         }
-                        ++i;
                     }
-                    else
-                        break;
+                    ++i;
+                }
+            }
         }
     });
 
@@ -187,15 +182,30 @@ int main(int argc, char *argv[]) {
 
     char *filename = argv[1];
 
-    uint32_t nEdge, vLeft, vRight;
+    uint64_t nEdge;
+    uint32_t vLeft, vRight;
 
-    graph G = readGraph(filename, nEdge, vLeft, vRight);
+    graph G;
+
+    // a cached graph has already been preprocessed
+    const bool cached = readCache(filename, G, nEdge, vLeft, vRight);
+
+    if (!cached) {
+        G = readGraph(filename, nEdge, vLeft, vRight);
+    }
 
     edges E;
 
     auto start = get_time();
 
-    preProcessing(G, vLeft, vRight, E);
+    if (!cached) {
+        std::vector<uint32_t> newID;
+        preProcessing(G, vLeft, vRight, newID);
+        writeCache(filename, G, nEdge, vLeft, vRight);
+    }
+
+    buildEdges(G, vLeft, E);
+    orientGraph(G, vLeft);
 
     uint64_t c = getCount(G, nEdge, vLeft, E);
     
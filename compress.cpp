@@ -0,0 +1,166 @@
+/* 
+    StreamVByte compression of the preprocessed graph's neighbor lists, which BTJ can count on
+*/
+
+#include "main.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <tmmintrin.h>
+#endif
+
+// byte length (1 to 4) StreamVByte uses for (delta)
+inline uint32_t deltaCode(uint32_t delta) {
+    return delta < (1u << 8) ? 0 : delta < (1u << 16) ? 1 : delta < (1u << 24) ? 2 : 3;
+}
+
+// neighbors encoded by each step of compressGraph, whose uncompressed rows are then released
+const uint64_t COMPRESS_BLOCK = (uint64_t) 1 << 20;
+
+/*
+Encodes the descending neighbor lists of the graph (G) as StreamVByte deltas (see compressedGraph), emptying G
+The encoded size of every list is computed first, so the lists are encoded in parallel into one array,
+one block of about COMPRESS_BLOCK neighbors after another; the array is only reserved, so just the
+encoded blocks are touched, and the uncompressed rows of each block are released once it is encoded,
+so G and its encoding are never both resident
+*/
+compressedGraph compressGraph(graph& G) {
+    const uint32_t n = G.size();
+    compressedGraph C;
+    C.offsets.resize((uint64_t) n + 1);
+    C.degrees.resize(n);
+
+    tbb::parallel_for(tbb::blocked_range<uint32_t>(0, n), [&](tbb::blocked_range<uint32_t> r) {
+        for (uint32_t x = r.begin(); x < r.end(); ++x) {
+            uint32_t prev = n;
+            uint64_t size = (G.degree(x) + 3) / 4;
+            for (uint32_t y : G[x]) {
+                size += deltaCode(prev - y) + 1;
+                prev = y;
+            }
+            // the padding deltas of a partial last group take one byte each
+            size += (4 - G.degree(x) % 4) % 4;
+            C.degrees[x] = G.degree(x);
+            C.offsets[x + 1] = size;
+        }
+    });
+
+    tbb::parallel_scan(tbb::blocked_range<uint32_t>(0, n), (uint64_t) 0,
+		[&](tbb::blocked_range<uint32_t> r, uint64_t sum, bool is_final_scan) {
+			uint64_t tmp = sum;
+			for (uint32_t x = r.begin(); x < r.end(); ++x) {
+                tmp += C.offsets[x + 1];
+				if (is_final_scan) {
+					C.offsets[x + 1] = tmp;
+				}
+			}
+			return tmp;
+		},
+		[](uint64_t a, uint64_t b) {
+			return a + b;
+	    }
+    );
+
+    // 16 bytes of slack let the decoder load whole groups past the last one
+    C.bytes.reserve(C.offsets[n] + 16);
+
+    const graph& rows = G;
+    for (uint32_t first = 0, last; first < n; first = last) {
+        last = std::upper_bound(G.offsets.data() + first + 1, G.offsets.data() + n, G.offsets[first] + COMPRESS_BLOCK) - G.offsets.data();
+        C.bytes.resize(C.offsets[last]);
+        tbb::parallel_for(tbb::blocked_range<uint32_t>(first, last), [&](tbb::blocked_range<uint32_t> r) {
+            for (uint32_t x = r.begin(); x < r.end(); ++x) {
+                const neighborSpan<const uint32_t> row = rows[x];
+                uint8_t *control = C.bytes.data() + C.offsets[x];
+                uint8_t *data = control + (row.size() + 3) / 4;
+                uint32_t prev = n;
+                for (uint64_t i = 0; i < (row.size() + 3) / 4 * 4; ++i) {
+                    const uint32_t delta = i < row.size() ? prev - row[i] : 0;
+                    const uint32_t code = deltaCode(delta);
+                    if (i % 4 == 0) control[i / 4] = 0;
+                    control[i / 4] |= code << (2 * (i % 4));
+                    memcpy(data, &delta, code + 1);
+                    data += code + 1;
+                    if (i < row.size()) prev = row[i];
+                }
+            }
+        });
+        G.neighbors.release(G.offsets[first], G.offsets[last]);
+    }
+    C.bytes.resize(C.offsets[n] + 16);
+
+    G = graph();
+    return C;
+}
+
+// shuffle masks and lengths of the groups of four deltas described by each control byte
+struct groupTables {
+    uint8_t shuffle[256][16];
+    uint8_t length[256];
+    groupTables() {
+        for (uint32_t c = 0; c < 256; ++c) {
+            uint8_t pos = 0;
+            for (uint32_t k = 0; k < 4; ++k) {
+                const uint32_t bytes = ((c >> (2 * k)) & 3) + 1;
+                for (uint32_t j = 0; j < 4; ++j) {
+                    shuffle[c][4 * k + j] = j < bytes ? pos + j : 0x80;
+                }
+                pos += bytes;
+            }
+            length[c] = pos;
+        }
+    }
+};
+
+const groupTables GROUP_TABLES;
+
+uint64_t decodeScalar(const uint8_t *control, const uint8_t *data, uint64_t numGroups, uint32_t prev, int64_t above, uint32_t *out) {
+    uint64_t g = 0;
+    while (g < numGroups) {
+        const uint32_t c = control[g++];
+        for (uint32_t k = 0; k < 4; ++k) {
+            const uint32_t bytes = ((c >> (2 * k)) & 3) + 1;
+            uint32_t delta = 0;
+            memcpy(&delta, data, bytes);
+            data += bytes;
+            prev -= delta;
+            *out++ = prev;
+        }
+        if (above >= 0 && prev <= above) break;
+    }
+    return 4 * g;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// decodes a group of four deltas with one shuffle and their descending prefix with two shifted subtractions
+__attribute__((target("ssse3")))
+uint64_t decodeSSSE3(const uint8_t *control, const uint8_t *data, uint64_t numGroups, uint32_t prev, int64_t above, uint32_t *out) {
+    __m128i last = _mm_set1_epi32(prev);
+    uint64_t g = 0;
+    while (g < numGroups) {
+        const uint32_t c = control[g++];
+        __m128i d = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) data), _mm_loadu_si128((const __m128i *) GROUP_TABLES.shuffle[c]));
+        data += GROUP_TABLES.length[c];
+        d = _mm_add_epi32(d, _mm_slli_si128(d, 4));
+        d = _mm_add_epi32(d, _mm_slli_si128(d, 8));
+        const __m128i v = _mm_sub_epi32(last, d);
+        _mm_storeu_si128((__m128i *) out, v);
+        out += 4;
+        last = _mm_shuffle_epi32(v, 0xFF);
+        if (above >= 0 && (uint32_t) _mm_cvtsi128_si32(last) <= above) break;
+    }
+    return 4 * g;
+}
+
+const bool HAS_SSSE3 = __builtin_cpu_supports("ssse3");
+#endif
+
+uint64_t compressedGraph::decode(uint32_t x, uint32_t *out, int64_t above) const {
+    const uint8_t *control = bytes.data() + offsets[x];
+    const uint64_t numGroups = ((uint64_t) degrees[x] + 3) / 4;
+#if defined(__x86_64__) || defined(__i386__)
+    if (HAS_SSSE3) {
+        return decodeSSSE3(control, control + numGroups, numGroups, size(), above, out);
+    }
+#endif
+    return decodeScalar(control, control + numGroups, numGroups, size(), above, out);
+}
@@ -0,0 +1,51 @@
+/* 
+    Converts a simple bipartite graph text file into a binary CSR snapshot, 
+    which all algorithms load directly instead of parsing the text file
+
+    To run:
+        g++ -o convert convert.cpp preProcessing.cpp intersect.cpp compress.cpp utilities.cpp -std=c++17 -O3 -fopenmp -ltbb -lz
+        ./convert <path_to_dataset> <path_to_snapshot>
+    
+    Dataset format:
+        |E| |U| |V|
+        u1 v1
+        u2 v1
+        u2 v2
+    
+    Example dataset:
+        3 2 2
+        0 0
+        0 1
+        1 0
+*/
+
+#include "main.h"
+
+int main(int argc, char *argv[]) {
+
+    if (argc < 3) {
+		std::cout << "Usage: " << argv[0] << " <path_to_dataset> <path_to_snapshot>" << "\n";
+        return 1;
+	}
+
+    uint64_t nEdge;
+    uint32_t vLeft, vRight;
+
+    auto start = get_time();
+
+    idMap ids;
+    graph G = readGraph(argv[1], nEdge, vLeft, vRight, ids);
+
+    writeGraph(argv[2], G, nEdge, vLeft, vRight);
+
+    // the snapshot holds dense IDs; the original identifiers of remapped inputs are kept next to it
+    if (remapMode() != REMAP_NONE) {
+        writeIDs((std::string(argv[2]) + ".ids").c_str(), ids, vLeft, vRight);
+    }
+
+    auto finish = get_time();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(finish-start);
+    std::cout << "Elapsed time = " << duration.count() << " milliseconds\n";
+
+    return 0;
+}
@@ -0,0 +1,258 @@
+/* 
+    Set intersection kernels and the strategies the algorithms intersect neighbor lists with
+*/
+
+#include "main.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/*
+Set intersection kernels for descending lists of distinct values
+Each compares a block of one list with a block of the other, all pairs at once by comparing 
+against every rotation of the second block, then moves on from the block(s) holding the 
+smaller last value, so every pair of blocks is compared at most once; the rest is merged
+*/
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("sse4.2,popcnt")))
+uint64_t intersectSSE42(const uint32_t *a, uint64_t na, const uint32_t *b, uint64_t nb) {
+    uint64_t result = 0;
+    uint64_t i = 0, j = 0;
+    while (i + 4 <= na && j + 4 <= nb) {
+        const __m128i va = _mm_loadu_si128((const __m128i *) (a + i));
+        const __m128i vb = _mm_loadu_si128((const __m128i *) (b + j));
+        __m128i m = _mm_cmpeq_epi32(va, vb);
+        m = _mm_or_si128(m, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1))));
+        m = _mm_or_si128(m, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))));
+        m = _mm_or_si128(m, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3))));
+        result += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(m)));
+        const uint32_t lastA = a[i + 3];
+        const uint32_t lastB = b[j + 3];
+        i += lastA >= lastB ? 4 : 0;
+        j += lastB >= lastA ? 4 : 0;
+    }
+    return result + intersectScalar(a + i, na - i, b + j, nb - j);
+}
+
+__attribute__((target("avx2,popcnt")))
+uint64_t intersectAVX2(const uint32_t *a, uint64_t na, const uint32_t *b, uint64_t nb) {
+    uint64_t result = 0;
+    uint64_t i = 0, j = 0;
+    while (i + 8 <= na && j + 8 <= nb) {
+        const __m256i va = _mm256_loadu_si256((const __m256i *) (a + i));
+        const __m256i vb = _mm256_loadu_si256((const __m256i *) (b + j));
+        // the rotations by 1 to 3 of each half, and the same four of the swapped halves
+        const __m256i vs = _mm256_permute2x128_si256(vb, vb, 1);
+        __m256i m = _mm256_or_si256(_mm256_cmpeq_epi32(va, vb), _mm256_cmpeq_epi32(va, vs));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1))));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3))));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(vs, _MM_SHUFFLE(0, 3, 2, 1))));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(vs, _MM_SHUFFLE(1, 0, 3, 2))));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi32(va, _mm256_shuffle_epi32(vs, _MM_SHUFFLE(2, 1, 0, 3))));
+        result += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(m)));
+        const uint32_t lastA = a[i + 7];
+        const uint32_t lastB = b[j + 7];
+        i += lastA >= lastB ? 8 : 0;
+        j += lastB >= lastA ? 8 : 0;
+    }
+    return result + intersectSSE42(a + i, na - i, b + j, nb - j);
+}
+
+__attribute__((target("avx512f,popcnt")))
+uint64_t intersectAVX512(const uint32_t *a, uint64_t na, const uint32_t *b, uint64_t nb) {
+    uint64_t result = 0;
+    uint64_t i = 0, j = 0;
+    __m512i rotations[16];
+    for (uint32_t k = 0; k < 16; ++k) {
+        rotations[k] = _mm512_and_si512(_mm512_add_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15), 
+                                                         _mm512_set1_epi32(k)), _mm512_set1_epi32(15));
+    }
+    while (i + 16 <= na && j + 16 <= nb) {
+        const __m512i va = _mm512_loadu_si512((const void *) (a + i));
+        const __m512i vb = _mm512_loadu_si512((const void *) (b + j));
+        // the rotations are independent of each other, so the compares overlap
+        __mmask16 m = _mm512_cmpeq_epi32_mask(va, vb);
+        for (uint32_t k = 1; k < 16; ++k) {
+            m |= _mm512_cmpeq_epi32_mask(va, _mm512_maskz_permutexvar_epi32(0xFFFF, rotations[k], vb));
+        }
+        result += __builtin_popcount(m);
+        const uint32_t lastA = a[i + 15];
+        const uint32_t lastB = b[j + 15];
+        i += lastA >= lastB ? 16 : 0;
+        j += lastB >= lastA ? 16 : 0;
+    }
+    return result + intersectAVX2(a + i, na - i, b + j, nb - j);
+}
+#endif
+
+/*
+The kernel selected by PAR6CYCLE_SIMD ("scalar", "sse4.2", "avx2" or "avx512"), checked against 
+the CPU once at startup; by default AVX2, else SSE4.2, else the scalar merge
+AVX-512 is not the default: its 16 value blocks skip less of skewed lists, and it measured 
+slower than AVX2 at every size ratio (see README)
+The block compares count a repeated value once for every match in the other block, so when 
+duplicate edges are kept, the scalar merge is always used
+*/
+intersectionKernel chooseIntersection() {
+    const char *simd = getenv("PAR6CYCLE_SIMD");
+    const std::string requested = simd == NULL ? "" : simd;
+    if (requested == "scalar" || !normalizing()) {
+        return {"scalar", intersectScalar};
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    const bool sse42 = __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt");
+    const bool avx2 = sse42 && __builtin_cpu_supports("avx2");
+    const bool avx512 = avx2 && __builtin_cpu_supports("avx512f");
+    if (requested == "avx512" && avx512) {
+        return {"AVX-512", intersectAVX512};
+    }
+    if ((requested == "avx2" || requested == "") && avx2) {
+        return {"AVX2", intersectAVX2};
+    }
+    if ((requested == "sse4.2" || requested == "") && sse42) {
+        return {"SSE4.2", intersectSSE42};
+    }
+#endif
+    if (requested != "") {
+        std::cout << "Error: PAR6CYCLE_SIMD=" << requested << " is not supported" << std::endl;
+        exit(1);
+    }
+    return {"scalar", intersectScalar};
+}
+
+const intersectionKernel INTERSECTION = chooseIntersection();
+
+const bool DISTINCT_NEIGHBORS = normalizing();
+
+intersectionTuning INTERSECTION_TUNING;
+
+uint32_t cheapestStrategy(uint64_t na, bool bitmapA, uint64_t nb, bool bitmapB) {
+    const intersectionTuning& t = INTERSECTION_TUNING;
+    if (na == 0 || nb == 0) {
+        return INTERSECT_MERGE;
+    }
+    uint32_t strategy = INTERSECT_MERGE;
+    uint64_t best = 16 * (na + nb);
+    const uint64_t shorter = std::min(na, nb);
+    const uint64_t longer = std::max(na, nb);
+    // steps per value ~ log2(longer / shorter) + 1, from the bit lengths to spare a division
+    const uint64_t gallop = shorter * t.gallop * (1 + __builtin_clzll(shorter) - __builtin_clzll(longer));
+    if (gallop < best) {
+        strategy = INTERSECT_GALLOP;
+        best = gallop;
+    }
+    if (bitmapB && na * t.bitmap < best) {
+        strategy = INTERSECT_BITMAP_B;
+        best = na * t.bitmap;
+    }
+    if (bitmapA && nb * t.bitmap < best) {
+        strategy = INTERSECT_BITMAP_A;
+    }
+    return strategy;
+}
+
+uint64_t gallopSize(const uint32_t *a, uint64_t na, const uint32_t *b, uint64_t nb) {
+    uint64_t result = 0;
+    gallopCommon(a, na, b, nb, [&](uint32_t) {++result;});
+    return result;
+}
+
+// the fastest of a few runs of (run), in nanoseconds
+double fastestRun(const std::function<uint64_t()>& run) {
+    double best = 1e30;
+    volatile uint64_t sink = 0;
+    for (uint32_t round = 0; round < 5; ++round) {
+        const auto start = get_time();
+        sink = sink + run();
+        best = std::min(best, (double) std::chrono::duration_cast<std::chrono::nanoseconds>(get_time() - start).count());
+    }
+    return best;
+}
+
+/*
+Sets INTERSECTION_TUNING from timings of the strategies on random lists: merges of pairs of up 
+to 16 values, gallops of 64 values through 4096 and probes of 4096 values into a bitmap over 
+(vRight) values like those of the hubs; takes a few milliseconds and only runs with PAR6CYCLE_TUNE=1, 
+as the timings vary from run to run, and so would the strategies; otherwise the defaults are kept
+*/
+void tuneIntersections(const uint32_t vRight) {
+    const char *tune = getenv("PAR6CYCLE_TUNE");
+    if (tune == NULL || strcmp(tune, "0") == 0) {
+        return;
+    }
+    uint64_t state = 88172645463325252ull;
+    auto random = [&state]() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    };
+    // (n) descending values with gaps of 1 to 2 * (gap)
+    auto randomList = [&](uint64_t n, uint64_t gap) {
+        std::vector<uint32_t> list(n);
+        uint32_t x = UINT32_MAX;
+        for (uint64_t i = 0; i < n; ++i) {
+            x -= 1 + random() % (2 * gap);
+            list[i] = x;
+        }
+        return list;
+    };
+
+    // most intersections are of short lists, which are merged without SIMD
+    std::vector<std::vector<uint32_t>> pairs;
+    for (uint32_t i = 0; i < 512; ++i) {
+        pairs.push_back(randomList(1 + random() % 16, 2));
+    }
+    uint64_t merged = 0;
+    for (uint32_t i = 0; i < pairs.size(); i += 2) {
+        merged += pairs[i].size() + pairs[i + 1].size();
+    }
+    const double merge = fastestRun([&] {
+        uint64_t result = 0;
+        for (uint32_t rep = 0; rep < 16; ++rep) {
+            for (uint32_t i = 0; i < pairs.size(); i += 2) {
+                mergeCommon(pairs[i].data(), pairs[i].size(), pairs[i + 1].data(), pairs[i + 1].size(), [&](uint32_t) {++result;});
+            }
+        }
+        return result;
+    }) / (16 * merged);
+
+    const std::vector<uint32_t> longer = randomList(4096, 2);
+    std::vector<uint32_t> shorter;
+    for (uint64_t i = 0; i < longer.size(); i += 64) {
+        shorter.push_back(longer[i + random() % 64] - random() % 2);
+    }
+    const double gallop = fastestRun([&] {
+        uint64_t result = 0;
+        for (uint32_t rep = 0; rep < 16; ++rep) {
+            result += gallopSize(shorter.data(), shorter.size(), longer.data(), longer.size());
+        }
+        return result;
+    }) / (16 * shorter.size() * (64 - __builtin_clzll(longer.size() / shorter.size())));
+
+    const uint32_t universe = std::max(vRight, (uint32_t) 64);
+    std::vector<uint64_t> bitmap((universe + 63) / 64);
+    for (uint64_t& word : bitmap) {
+        word = random();
+    }
+    std::vector<uint32_t> probes(4096);
+    for (uint32_t& x : probes) {
+        x = random() % universe;
+    }
+    const double probe = fastestRun([&] {
+        uint64_t result = 0;
+        for (uint32_t rep = 0; rep < 16; ++rep) {
+            result += bitmapSize(probes.data(), probes.size(), bitmap.data(), 0);
+        }
+        return result;
+    }) / (16 * probes.size());
+
+    if (merge > 0) {
+        INTERSECTION_TUNING.gallop = std::clamp(16 * gallop / merge + 0.5, 1.0, 65536.0);
+        INTERSECTION_TUNING.bitmap = std::clamp(16 * probe / merge + 0.5, 1.0, 65536.0);
+    }
+    std::cout << "Intersection costs per merged value: " << INTERSECTION_TUNING.gallop / 16.0 << " per galloping step, " 
+              << INTERSECTION_TUNING.bitmap / 16.0 << " per bitmap probe" << std::endl;
+}
@@ -5,24 +5,613 @@
 #ifndef MAIN_H
 #define MAIN_H
 
+#include <algorithm>
+#include <cerrno>
 #include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iterator>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 #include <queue>
+#include <thread>
+// observers of a single task arena (see forEachNode) are a preview feature of older TBB releases
+#define TBB_PREVIEW_LOCAL_OBSERVER 1
+
 #include "parallel_hashmap/phmap.h"
 #include "parallel_hashmap/phmap_utils.h"
 #include "tbb/parallel_for.h"
 #include "tbb/parallel_reduce.h"
 #include "tbb/parallel_sort.h"
 #include "tbb/parallel_scan.h"
+#include "tbb/concurrent_queue.h"
+#include "tbb/enumerable_thread_specific.h"
+#include "tbb/task_arena.h"
+#include "tbb/task_scheduler_observer.h"
 
+#include <dirent.h>
 #include <fcntl.h>
+#include <glob.h>
+#include <sched.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <zlib.h>
+
+// how large arrays are backed, selected by PAR6CYCLE_HUGEPAGES
+const uint32_t HUGEPAGES_OFF = 0;       // regular pages from the heap
+const uint32_t HUGEPAGES_MADVISE = 1;   // 2 MB aligned mappings marked with MADV_HUGEPAGE
+const uint32_t HUGEPAGES_HUGETLB = 2;   // MAP_HUGETLB mappings, falling back to MADV_HUGEPAGE
+
+// allocations from this size on are backed by huge pages
+const uint64_t HUGE_PAGE_SIZE = (uint64_t) 2 << 20;
+
+void *allocateHuge(uint64_t size);
+void freeHuge(void *p, uint64_t size);
+
+// allocator of the large graph and scratch arrays, which backs them by huge pages (see allocateHuge)
+template <typename T>
+struct hugePageAllocator {
+    typedef T value_type;
+    hugePageAllocator() = default;
+    template <typename U>
+    hugePageAllocator(const hugePageAllocator<U>&) {}
+    T *allocate(size_t n) {return (T *) allocateHuge(n * sizeof(T));}
+    void deallocate(T *p, size_t n) {freeHuge(p, n * sizeof(T));}
+};
+
+template <typename T, typename U>
+bool operator==(const hugePageAllocator<T>&, const hugePageAllocator<U>&) {return true;}
+template <typename T, typename U>
+bool operator!=(const hugePageAllocator<T>&, const hugePageAllocator<U>&) {return false;}
+
+template <typename T>
+using hugeVector = std::vector<T, hugePageAllocator<T>>;
+
+/*
+Array of a graph, either owned (a hugeVector) or a view of a mapped snapshot, which stays mapped 
+as long as an array refers to it (see readBinaryGraph); resizing a view makes it owned
+*/
+template <typename T>
+struct graphArray {
+    hugeVector<T> owned;
+    T *first = NULL;
+    uint64_t length = 0;
+    std::shared_ptr<char> mapping;
+
+    graphArray() = default;
+    graphArray(const graphArray&) = delete;
+    graphArray& operator=(const graphArray&) = delete;
+    graphArray(graphArray&&) = default;
+    graphArray& operator=(graphArray&&) = default;
+    graphArray& operator=(hugeVector<T>&& values) {
+        owned = std::move(values);
+        mapping.reset();
+        first = owned.data();
+        length = owned.size();
+        return *this;
+    }
+
+    // the (n) values at (p), which lies in (m)
+    void view(T *p, uint64_t n, const std::shared_ptr<char>& m) {
+        owned = hugeVector<T>();
+        mapping = m;
+        first = p;
+        length = n;
+    }
+
+    void resize(uint64_t n) {
+        if (mapping != NULL) {
+            hugeVector<T> values(first, first + std::min(n, length));
+            values.resize(n);
+            *this = std::move(values);
+            return;
+        }
+        owned.resize(n);
+        first = owned.data();
+        length = n;
+    }
+    void assign(uint64_t n, const T& value) {
+        *this = hugeVector<T>(n, value);
+    }
+    // gives the whole pages of the values [begin, end) back to the system, after which they must not be read
+    void release(uint64_t begin, uint64_t end) {
+        const uintptr_t page = sysconf(_SC_PAGESIZE);
+        const uintptr_t low = ((uintptr_t) (first + begin) + page - 1) & ~(page - 1);
+        const uintptr_t high = (uintptr_t) (first + end) & ~(page - 1);
+        if (low < high) {
+            madvise((void *) low, high - low, MADV_DONTNEED);
+        }
+    }
+
+    T *data() {return first;}
+    const T *data() const {return first;}
+    uint64_t size() const {return length;}
+    T& operator[](uint64_t i) {return first[i];}
+    const T& operator[](uint64_t i) const {return first[i];}
+};
+
+// number of the values in both descending lists of distinct values [a, a + na) and [b, b + nb)
+inline uint64_t intersectScalar(const uint32_t *a, uint64_t na, const uint32_t *b, uint64_t nb) {
+    uint64_t result = 0;
+    const uint32_t *lastA = a + na;
+    const uint32_t *lastB = b + nb;
+    while (a != lastA && b != lastB) {
+        if (*a > *b) ++a;
+        else if (*b > *a) ++b;
+        else {
+            result += 1;
+            ++a;
+            ++b;
+        }
+    }
+    return result;
+}
+
+// a set intersection kernel (see intersect.cpp) and its instruction set
+struct intersectionKernel {
+    const char *name;
+    uint64_t (*count)(const uint32_t *a, uint64_t na, const uint32_t *b, uint64_t nb);
+};
+
+extern const intersectionKernel INTERSECTION;
+
+// lists shorter than this are merged inline rather than by the SIMD kernel
+const uint64_t SIMD_INTERSECTION_SIZE = 8;
+
+// |A and B| by a merge, with the SIMD kernel unless a list is short
+inline uint64_t mergeSize(const uint32_t *a, uint64_t na, const uint32_t *b, uint64_t nb) {
+    if (na < SIMD_INTERSECTION_SIZE || nb < SIMD_INTERSECTION_SIZE) {
+        return intersectScalar(a, na, b, nb);
+    }
+    return INTERSECTION.count(a, na, b, nb);
+}
+
+// calls f(x) for every x in both descending lists A and B, by a merge
+template <typename F>
+inline void mergeCommon(const uint32_t *a, uint64_t na, const uint32_t *b, uint64_t nb, F f) {
+    const uint32_t *lastA = a + na;
+    const uint32_t *lastB = b + nb;
+    while (a != lastA && b != lastB) {
+        if (*a > *b) ++a;
+        else if (*b > *a) ++b;
+        else {
+            f(*a);
+            ++a;
+            ++b;
+        }
+    }
+}
+
+/*
+Calls f(x) for every x in both descending lists A and B, where A is the shorter list: each x 
+of A is searched for in B from where the previous search ended, by doubling steps and then a 
+binary search, so it takes O(|A| log(|B| / |A|)) steps
+If (Repeat), a match does not use up the value of B, so every copy of a value of A in B is reported
+*/
+template <bool Repeat = false, typename F>
+inline void gallopCommon(const uint32_t *a, uint64_t na, const uint32_t *b, uint64_t nb, F f) {
+    uint64_t j = 0;
+    for (uint64_t i = 0; i < na && j < nb; ++i) {
+        const uint32_t x = a[i];
+        // the first index from j whose value is not above x lies in (low, high]
+        uint64_t low = j, step = 1;
+        if (b[j] > x) {
+            while (j + step < nb && b[j + step] > x) {
+                low = j + step;
+                step *= 2;
+            }
+            // branchless binary search, keeping b[low] > x and the index in (low, low + n]
+            uint64_t n = std::min(j + step, nb) - low;
+            while (n > 1) {
+                const uint64_t half = n / 2;
+                low = b[low + half] > x ? low + half : low;
+                n -= half;
+            }
+            j = low + 1;
+        }
+        if (j < nb && b[j] == x) {
+            f(x);
+            j += !Repeat;
+        }
+    }
+}
+
+// calls f(x) for every x of list A whose bit x - base is set in (bitmap)
+template <typename F>
+inline void bitmapCommon(const uint32_t *a, uint64_t na, const uint64_t *bitmap, uint32_t base, F f) {
+    for (uint64_t i = 0; i < na; ++i) {
+        if (bitmap[(a[i] - base) >> 6] >> ((a[i] - base) & 63) & 1) {
+            f(a[i]);
+        }
+    }
+}
+
+// number of the values of list A whose bit x - base is set in (bitmap), without branches
+inline uint64_t bitmapSize(const uint32_t *a, uint64_t na, const uint64_t *bitmap, uint32_t base) {
+    uint64_t result = 0;
+    for (uint64_t i = 0; i < na; ++i) {
+        result += bitmap[(a[i] - base) >> 6] >> ((a[i] - base) & 63) & 1;
+    }
+    return result;
+}
+
+// calls f(x) for every copy of a value x of list A that is in list B, testing against the bitmap of B if not NULL
+template <typename F>
+inline void probeCommon(const uint32_t *a, uint64_t na, const uint32_t *b, uint64_t nb, const uint64_t *bitmapB, uint32_t base, F f) {
+    if (bitmapB != NULL) bitmapCommon(a, na, bitmapB, base, f);
+    else gallopCommon<true>(a, na, b, nb, f);
+}
+
+// whether neighbor lists hold distinct values, i.e. duplicate edges are dropped (see normalizing)
+extern const bool DISTINCT_NEIGHBORS;
+
+/*
+Relative costs of the intersection strategies, in 1/16 of the merge cost of one list value: 
+a galloping search costs (gallop) per doubling of the length ratio, a bitmap probe (bitmap)
+Set by tuneIntersections for the CPU and the size of the bitmaps if PAR6CYCLE_TUNE=1, otherwise left at the defaults
+*/
+struct intersectionTuning {
+    uint32_t gallop = 96;
+    uint32_t bitmap = 24;
+};
+
+extern intersectionTuning INTERSECTION_TUNING;
+
+void tuneIntersections(const uint32_t vRight);
+
+const uint32_t INTERSECT_MERGE = 0;     // walk both lists
+const uint32_t INTERSECT_GALLOP = 1;    // search the values of the shorter list in the longer
+const uint32_t INTERSECT_BITMAP_A = 2;  // test the values of B against the bitmap of A
+const uint32_t INTERSECT_BITMAP_B = 3;  // test the values of A against the bitmap of B
+
+// the cheapest strategy for lists of (na) and (nb) values by the costs of INTERSECTION_TUNING;
+// a merge if either is empty
+uint32_t cheapestStrategy(uint64_t na, bool bitmapA, uint64_t nb, bool bitmapB);
+
+/*
+The strategy for lists of (na) and (nb) values, of which A and B may have bitmaps: the shorter 
+list is tested against the other's bitmap if there is one, since it touches fewer values than 
+merging or galloping with it would, and otherwise the costs are compared
+When duplicate edges are kept, lists are always merged, as a bitmap counts every copy of a value
+*/
+inline uint32_t intersectionStrategy(uint64_t na, bool bitmapA, uint64_t nb, bool bitmapB) {
+    if (!DISTINCT_NEIGHBORS) return INTERSECT_MERGE;
+    if (bitmapB && na <= nb) return INTERSECT_BITMAP_B;
+    if (bitmapA && nb <= na) return INTERSECT_BITMAP_A;
+    return cheapestStrategy(na, bitmapA, nb, bitmapB);
+}
+
+/*
+Calls f(x) for every x in both descending lists A and B of distinct values, by the strategy 
+intersectionStrategy picks; (bitmapA) and (bitmapB), if not NULL, tell with bit x - base 
+whether a value x of the other list is in A and B respectively
+When duplicate edges are kept, every copy of a value of the shorter list (B if as long) that is 
+in the other list is reported instead
+*/
+template <typename F>
+inline void forEachCommon(const uint32_t *a, uint64_t na, const uint64_t *bitmapA, 
+                          const uint32_t *b, uint64_t nb, const uint64_t *bitmapB, uint32_t base, F f) {
+    if (!DISTINCT_NEIGHBORS) {
+        if (na < nb) probeCommon(a, na, b, nb, bitmapB, base, f);
+        else probeCommon(b, nb, a, na, bitmapA, base, f);
+        return;
+    }
+    switch (intersectionStrategy(na, bitmapA != NULL, nb, bitmapB != NULL)) {
+        case INTERSECT_GALLOP:
+            if (na <= nb) gallopCommon(a, na, b, nb, f);
+            else gallopCommon(b, nb, a, na, f);
+            break;
+        case INTERSECT_BITMAP_A:
+            bitmapCommon(b, nb, bitmapA, base, f);
+            break;
+        case INTERSECT_BITMAP_B:
+            bitmapCommon(a, na, bitmapB, base, f);
+            break;
+        default:
+            mergeCommon(a, na, b, nb, f);
+    }
+}
+
+// |A and B| by galloping, where A is the shorter list (see gallopCommon)
+uint64_t gallopSize(const uint32_t *a, uint64_t na, const uint32_t *b, uint64_t nb);
+
+// |A and B| by the strategy intersectionStrategy picks, with bitmaps as in forEachCommon
+inline uint64_t intersectionSize(const uint32_t *a, uint64_t na, const uint64_t *bitmapA, 
+                                 const uint32_t *b, uint64_t nb, const uint64_t *bitmapB, uint32_t base) {
+    const uint32_t strategy = intersectionStrategy(na, bitmapA != NULL, nb, bitmapB != NULL);
+    if (strategy == INTERSECT_BITMAP_B) return bitmapSize(a, na, bitmapB, base);
+    if (strategy == INTERSECT_BITMAP_A) return bitmapSize(b, nb, bitmapA, base);
+    if (strategy == INTERSECT_GALLOP) return na <= nb ? gallopSize(a, na, b, nb) : gallopSize(b, nb, a, na);
+    return mergeSize(a, na, b, nb);
+}
+
+// how the graph and the counting work are spread over NUMA nodes, selected by PAR6CYCLE_NUMA
+const uint32_t NUMA_OFF = 0;        // first touch placement, one task arena
+const uint32_t NUMA_INTERLEAVE = 1; // large arrays interleaved page by page over the nodes
+const uint32_t NUMA_PARTITION = 2;  // rows of U placed on the node that processes them
+
+uint32_t numaMode();
+uint32_t numaNodes();
+std::vector<uint32_t> numaSplit(const uint32_t begin, const uint32_t end, const std::function<uint64_t(uint32_t)>& weight);
+void placeOnNode(const void *first, const void *last, const uint32_t node);
+void forEachNode(const uint32_t begin, const uint32_t end, const std::function<uint64_t(uint32_t)>& weight, 
+                 const std::function<void(uint32_t, uint32_t, uint32_t)>& body);
 
-typedef std::vector<std::vector<uint32_t>> graph;
+// view of the (size) neighbors at (first), used like the adjacency vector of a node
+template <typename T>
+struct neighborSpan {
+    T *first;
+    T *last;
+    T *begin() const {return first;}
+    T *end() const {return last;}
+    T *data() const {return first;}
+    uint64_t size() const {return last - first;}
+    bool empty() const {return first == last;}
+    T& operator[](uint64_t i) const {return first[i];}
+};
+
+/*
+Compressed sparse row graph: the neighbors of node x are neighbors[offsets[x], offsets[x + 1]),
+so the whole graph is two allocations, or two ranges of a mapped snapshot; G[x] is a view of x's neighbors
+Once oriented (see orientGraph), splits[offsets[x] + i] is the number of neighbors of y = G[x][i] 
+ranked above x for every left set node x, i.e. where x falls in y's descending neighbor list
+*/
+struct graph {
+    graphArray<uint64_t> offsets;
+    graphArray<uint32_t> neighbors;
+    hugeVector<uint32_t> splits;
+
+    graph() {offsets.assign(1, 0);}
+
+    uint32_t size() const {return offsets.size() - 1;}
+    uint64_t degree(uint32_t x) const {return offsets[x + 1] - offsets[x];}
+    neighborSpan<const uint32_t> operator[](uint32_t x) const {
+        return {neighbors.data() + offsets[x], neighbors.data() + offsets[x + 1]};
+    }
+    neighborSpan<uint32_t> operator[](uint32_t x) {
+        return {neighbors.data() + offsets[x], neighbors.data() + offsets[x + 1]};
+    }
+
+    // neighbors of G[x][i] ranked above the left set node x
+    neighborSpan<const uint32_t> higher(uint32_t x, uint64_t i) const {
+        const uint32_t *row = neighbors.data() + offsets[neighbors[offsets[x] + i]];
+        return {row, row + splits[offsets[x] + i]};
+    }
+    // neighbors of G[x][i] ranked below the left set node x
+    neighborSpan<const uint32_t> lower(uint32_t x, uint64_t i) const {
+        const uint32_t y = neighbors[offsets[x] + i];
+        const uint32_t *first = neighbors.data() + offsets[y] + splits[offsets[x] + i];
+        const uint32_t *last = neighbors.data() + offsets[y + 1];
+        while (first < last && *first == x) ++first;
+        return {first, last};
+    }
+
+    // the same accessors as compressedGraph, for kernels that take either representation
+    neighborSpan<const uint32_t> row(uint32_t x, std::vector<uint32_t>& /*buffer*/) const {
+        return (*this)[x];
+    }
+    neighborSpan<const uint32_t> higher(uint32_t x, uint64_t i, uint32_t /*y*/, std::vector<uint32_t>& /*buffer*/) const {
+        return higher(x, i);
+    }
+    void split(uint32_t x, uint64_t i, uint32_t /*y*/, std::vector<uint32_t>& /*buffer*/, 
+               neighborSpan<const uint32_t>& higher, neighborSpan<const uint32_t>& lower) const {
+        higher = this->higher(x, i);
+        lower = this->lower(x, i);
+    }
+
+    // sets up (n) rows where row x has (deg(x)) neighbors, which are then filled in through G[x]
+    template <typename Degree>
+    void resize(uint32_t n, Degree deg) {
+        offsets.assign((uint64_t) n + 1, 0);
+        tbb::parallel_scan(tbb::blocked_range<uint32_t>(0, n), (uint64_t) 0,
+            [&](tbb::blocked_range<uint32_t> r, uint64_t sum, bool is_final_scan) {
+                uint64_t tmp = sum;
+                for (uint32_t x = r.begin(); x < r.end(); ++x) {
+                    tmp += deg(x);
+                    if (is_final_scan) {
+                        offsets[x + 1] = tmp;
+                    }
+                }
+                return tmp;
+            },
+            [](uint64_t a, uint64_t b) {
+                return a + b;
+            }
+        );
+        neighbors.resize(offsets[n]);
+    }
+};
+
+/*
+Graph whose descending neighbor lists are stored as deltas in the StreamVByte layout: 
+the neighbors of node x are encoded from bytes[offsets[x]] as one control byte per group of four, 
+holding the 1 to 4 byte length of each delta, followed by the little-endian delta bytes
+The first delta of a list is taken from the number of nodes, and a partial last group is padded with 0s
+Neighbors are decoded into a buffer with room for degree(x) rounded up to a multiple of 4 values
+*/
+struct compressedGraph {
+    hugeVector<uint64_t> offsets;
+    hugeVector<uint32_t> degrees;
+    hugeVector<uint8_t> bytes;
+
+    uint32_t size() const {return degrees.size();}
+    uint64_t degree(uint32_t x) const {return degrees[x];}
+
+    /*
+    Decodes the neighbors of x to (out) and returns how many values were written, 
+    stopping after the first group holding a neighbor not above (above) if above >= 0
+    */
+    uint64_t decode(uint32_t x, uint32_t *out, int64_t above = -1) const;
+
+    // the neighbors of x, decoded into (buffer)
+    neighborSpan<const uint32_t> row(uint32_t x, std::vector<uint32_t>& buffer) const {
+        if (buffer.size() < degrees[x] + 3) buffer.resize(degrees[x] + 3);
+        decode(x, buffer.data());
+        return {buffer.data(), buffer.data() + degrees[x]};
+    }
+    // neighbors of y, the i-th neighbor of the left set node x, ranked above x, decoded into (buffer)
+    neighborSpan<const uint32_t> higher(uint32_t x, uint64_t /*i*/, uint32_t y, std::vector<uint32_t>& buffer) const {
+        if (buffer.size() < degrees[y] + 3) buffer.resize(degrees[y] + 3);
+        const uint32_t *last = buffer.data() + std::min<uint64_t>(degrees[y], decode(y, buffer.data(), x));
+        return {buffer.data(), std::partition_point((const uint32_t *) buffer.data(), last, [x](uint32_t z) {return z > x;})};
+    }
+    // neighbors of y, the i-th neighbor of the left set node x, ranked above (higher) and below (lower) x
+    void split(uint32_t x, uint64_t /*i*/, uint32_t y, std::vector<uint32_t>& buffer, 
+               neighborSpan<const uint32_t>& higher, neighborSpan<const uint32_t>& lower) const {
+        const neighborSpan<const uint32_t> r = row(y, buffer);
+        const uint32_t *mid = std::partition_point(r.begin(), r.end(), [x](uint32_t z) {return z > x;});
+        higher = {r.begin(), mid};
+        while (mid < r.end() && *mid == x) ++mid;
+        lower = {mid, r.end()};
+    }
+};
 
-typedef std::vector<phmap::flat_hash_set<uint32_t>> edges;
+// the neighbors of one left set node as its descending row [first, first + size), with a bitmap over the right set 
+// if it is a hub, which contains() then tests instead of searching the row
+struct edgeRow {
+    const uint32_t *first;
+    uint64_t size;
+    const uint64_t *bitmap;
+    uint32_t base;
+
+    bool contains(uint32_t y) const {
+        if (bitmap != NULL) {
+            return bitmap[(y - base) >> 6] >> ((y - base) & 63) & 1;
+        }
+        if (size == 0) {
+            return false;
+        }
+        // branchless binary search for the last neighbor not below y
+        const uint32_t *row = first;
+        uint64_t n = size;
+        while (n > 1) {
+            const uint64_t half = n / 2;
+            row = row[half] >= y ? row + half : row;
+            n -= half;
+        }
+        return *row == y;
+    }
+};
+
+// where the neighbors of a left set node are: (start) is the offset of its row, and (hub) is 1 + the number of its bitmap, 0 if it has none
+struct edgeRowInfo {
+    uint64_t start;
+    uint32_t size;
+    uint32_t hub;
+};
+
+/*
+Edge membership index of the left set nodes of a preprocessed graph (G), which it searches in place
+Rows of hubs, the nodes with at least hubDegree neighbors, also get a bitmap of (words) words over 
+the right set, which their membership tests use; the other rows are binary searched
+The right set nodes get no bitmaps: every test of the algorithms asks whether a right set node is 
+a neighbor of a left set node (the endpoints of the edges NJ, WJ and TJ look up, or the common 
+neighbors BTJ counts), so a bitmap over the left set would only answer the same tests again
+BTJ frees the rows of a compressed graph and sets (neighbors) to NULL, keeping only the bitmaps
+*/
+struct edges {
+    const uint32_t *neighbors = NULL;
+    uint32_t vLeft = 0;
+    uint64_t words = 0;
+    hugeVector<edgeRowInfo> rows;
+    hugeVector<uint64_t> bits;
+
+    edgeRow operator[](uint32_t u) const {
+        return {neighbors + rows[u].start, rows[u].size, bitmap(u), vLeft};
+    }
+    // the bitmap of the right set neighbors of u (bit v - vLeft for neighbor v) if u is a hub, otherwise NULL
+    const uint64_t *bitmap(uint32_t u) const {
+        return rows[u].hub != 0 ? bits.data() + (rows[u].hub - 1) * words : NULL;
+    }
+};
+
+/*
+By default, hubs have at least one in HUB_RATIO of the right set as neighbors, so a bitmap takes at most 32 bytes per neighbor, 
+and at least HUB_MIN_DEGREE neighbors, as a shorter row fits one cache line, which is binary searched about as fast as a bit is tested
+*/
+const uint64_t HUB_RATIO = 256;
+const uint64_t HUB_MIN_DEGREE = 16;
+
+typedef std::vector<std::pair<uint32_t, uint32_t>> edgeList;
+
+/*
+Reader for one edge list format; every format feeds the same parallel adjacency list builder
+    - sniff: whether an input starting with the (size) bytes at (f) is in this format
+    - parseHeader: parses the header at (f) and returns the offset of the first edge; 
+      counts the header does not provide are set to 0 and derived from the edges
+    - parseEdges: appends the edges in [begin, end), which holds complete records only, to E with 0-based IDs
+    - completeRecords: length of the longest prefix of the (size) bytes at (f) made of complete records
+    - text: whether the records are text lines, whose IDs may be arbitrary tokens when remapping
+*/
+struct edgeListFormat {
+    const char *name;
+    bool text;
+    bool (*sniff)(const char *f, uint64_t size);
+    uint64_t (*parseHeader)(const char *f, uint64_t size, uint64_t& nEdge, uint32_t& vLeft, uint32_t& vRight);
+    void (*parseEdges)(const char *begin, const char *end, edgeList& E);
+    uint64_t (*completeRecords)(const char *f, uint64_t size);
+};
+
+/*
+Header of a binary CSR snapshot, followed by:
+    - |U| + |V| + 1 uint64_t offsets, where node x's neighbors are [offsets[x], offsets[x + 1])
+    - the uint32_t neighbors of all nodes (right set nodes are numbered from |U|)
+*/
+struct csrHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t vLeft;
+    uint32_t vRight;
+    uint32_t reserved;
+    uint64_t nEdge;
+};
+
+const char CSR_MAGIC[8] = {'P', '6', 'C', 'C', 'S', 'R', '\0', '\0'};
+const uint32_t CSR_VERSION = 1;
+
+// identifies the contents of an input file
+struct fileFingerprint {
+    uint64_t size;
+    int64_t mtimeSec;
+    int64_t mtimeNsec;
+    uint64_t contentHash;
+};
+
+// header of a preprocessed graph cache, followed by the preprocessed graph as a binary CSR snapshot
+struct cacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t options;   // identifier mode and normalization the input was read with (see loadOptions)
+    fileFingerprint input;
+};
+
+const char CACHE_MAGIC[8] = {'P', '6', 'C', 'C', 'A', 'C', 'H', 'E'};
+const uint32_t CACHE_VERSION = 2;
+
+// new ID of nodes removed by preprocessing
+const uint32_t REMOVED_ID = UINT32_MAX;
+
+// how node identifiers are read, selected by PAR6CYCLE_REMAP
+const uint32_t REMAP_NONE = 0;      // dense 0-based IDs used as they are
+const uint32_t REMAP_NUMERIC = 1;   // arbitrary 64-bit IDs mapped to dense IDs
+const uint32_t REMAP_STRING = 2;    // arbitrary string IDs mapped to dense IDs
+
+/*
+Original identifiers of the nodes of a remapped input, indexed by dense ID 
+(right set nodes by their ID minus |U|); numeric IDs are kept in leftIDs and rightIDs, 
+string IDs in leftNames and rightNames
+*/
+struct idMap {
+    std::vector<uint64_t> leftIDs, rightIDs;
+    std::vector<std::string> leftNames, rightNames;
+};
 
 struct Sum {
     uint64_t value;
@@ -40,9 +629,31 @@ struct Sum {
 
 std::chrono::high_resolution_clock::time_point get_time();
 
-graph readGraph(const char *filename, uint32_t& nEdge, uint32_t& vLeft, uint32_t& vRight);
+uint32_t remapMode();
+graph readGraph(const char *filename, uint64_t& nEdge, uint32_t& vLeft, uint32_t& vRight);
+graph readGraph(const char *filename, uint64_t& nEdge, uint32_t& vLeft, uint32_t& vRight, idMap& ids);
+std::string originalID(const idMap& ids, const uint32_t x, const uint32_t vLeft);
+void writeIDs(const char *filename, const idMap& ids, const uint32_t vLeft, const uint32_t vRight);
+void writeGraph(const char *filename, const graph& G, const uint64_t nEdge, const uint32_t vLeft, const uint32_t vRight);
+
+bool readCache(const char *filename, graph& G, uint64_t& nEdge, uint32_t& vLeft, uint32_t& vRight);
+void writeCache(const char *filename, const graph& G, const uint64_t nEdge, const uint32_t vLeft, const uint32_t vRight);
+
+void preProcessing(graph& G, uint32_t& vLeft, uint32_t& vRight, std::vector<uint32_t>& newID);
+void buildEdges(const graph& G, const uint32_t vLeft, edges& E);
+void orientGraph(graph& G, const uint32_t vLeft);
+uint32_t twoHopBound(const graph& G, const uint32_t vLeft);
+bool normalizing();
+bool compressing();
+bool verbose();
+uint64_t hubDegree(const uint32_t vRight);
+
+// how BTJ counts |N(a) and N(b) and N(c)| of the (a, c) pairs of a b, selected by PAR6CYCLE_TRIPLES
+const uint32_t TRIPLES_AUTO = 0;    // the cheaper of the two below by a cost estimate, per b
+const uint32_t TRIPLES_PAIRS = 1;   // one list intersection per pair
+const uint32_t TRIPLES_MARKER = 2;  // one pass over N(b) that counts every pair in a table
 
-void preProcessing(graph& G, uint32_t& vLeft, uint32_t& vRight);
-void preProcessing(graph& G, uint32_t& vLeft, uint32_t& vRight, edges& E);
+uint32_t triplesMode();
+compressedGraph compressGraph(graph& G);
 
 #endif
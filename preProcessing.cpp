@@ -55,8 +55,9 @@ void Compute2Core(graph& G, uint32_t& vLeft, uint32_t& vRight, std::vector<int>&
 /* 
 Given a graph (G), filter out nodes which are not in a 2-core and rename accordingly 
 (i.e. if node 2 is removed, then node 3 is renamed to node 2, node 4 is renamed to node 3, and so on)
+The new name of every node (or REMOVED_ID) is written to (coreID)
 */
-void Obtain2Core(graph& G, uint32_t& vLeft, uint32_t& vRight) {
+void Obtain2Core(graph& G, uint32_t& vLeft, uint32_t& vRight, std::vector<uint32_t>& coreID) {
     uint32_t newVLeft = vLeft;
     uint32_t newVRight = vRight;
     std::vector<int> newID;
@@ -84,17 +85,35 @@ void Obtain2Core(graph& G, uint32_t& vLeft, uint32_t& vRight) {
 	    }
     );
 
-    graph newG(newVLeft + newVRight);
+    // coreNodes[x_id] = original ID of the 2-core node renamed to x_id
+    std::vector<uint32_t> coreNodes(newVLeft + newVRight);
+    coreID.resize(vLeft + vRight);
+    auto inCore = [&](uint32_t x) {return (x == 0 && newID[x] == 0) || (x > 0 && newID[x] != newID[x - 1]);};
 
     tbb::parallel_for(tbb::blocked_range<uint32_t>(0, vLeft + vRight), [&](tbb::blocked_range<uint32_t> r) {
         for (uint32_t x = r.begin(); x < r.end(); ++x) {
-            const uint32_t x_id = newID[x];
-            if ((x == 0 && x_id == 0) || (x > 0 && x_id != newID[x - 1])) {
-                for (uint32_t y : G[x]) {
-                    const uint32_t y_id = newID[y];
-                    if ((y == 0 && y_id == 0) || (y > 0 && y_id != newID[y - 1])) {
-                        newG[x_id].emplace_back(y_id);
-                    }
+            coreID[x] = REMOVED_ID;
+            if (inCore(x)) {
+                coreID[x] = newID[x];
+                coreNodes[newID[x]] = x;
+            }
+        }
+    });
+
+    graph newG;
+    newG.resize(newVLeft + newVRight, [&](uint32_t x_id) {
+        uint64_t deg = 0;
+        for (uint32_t y : G[coreNodes[x_id]])
+            deg += inCore(y);
+        return deg;
+    });
+
+    tbb::parallel_for(tbb::blocked_range<uint32_t>(0, newVLeft + newVRight), [&](tbb::blocked_range<uint32_t> r) {
+        for (uint32_t x_id = r.begin(); x_id < r.end(); ++x_id) {
+            uint32_t *out = newG[x_id].begin();
+            for (uint32_t y : G[coreNodes[x_id]]) {
+                if (inCore(y)) {
+                    *out++ = newID[y];
                 }
             }
         }
@@ -104,31 +123,56 @@ void Obtain2Core(graph& G, uint32_t& vLeft, uint32_t& vRight) {
     vRight = newVRight;
 }
 
+/*
+Returns a bound on the number of left set nodes two hops away from any left set node x: the number 
+of wedges from x, i.e. the sum of deg(y) - 1 over its neighbors y, capped at vLeft - 1
+BTJ sizes the scratch of every thread by it instead of by vLeft
+*/
+uint32_t twoHopBound(const graph& G, const uint32_t vLeft) {
+    const uint64_t wedges = tbb::parallel_reduce(tbb::blocked_range<uint32_t>(0, vLeft), (uint64_t) 0, 
+        [&](tbb::blocked_range<uint32_t> r, uint64_t most) {
+            for (uint32_t x = r.begin(); x < r.end(); ++x) {
+                uint64_t count = 0;
+                for (uint32_t y : G[x]) {
+                    count += G.degree(y) - 1;
+                }
+                most = std::max(most, count);
+            }
+            return most;
+        }, 
+        [](uint64_t a, uint64_t b) {return std::max(a, b);});
+    return std::min(wedges, (uint64_t) vLeft - 1);
+}
+
 /*
 Preprocesses the graph (G) by:
     - Filtering out nodes not in a 2-core
     - Swaps left and right sets s.t. the left set has the smaller number of nodes
     - Sorts left set by increasing 2-path counts
+    - Outputs the new ID of every original node, or REMOVED_ID if it is not in the 2-core (newID)
 */
-void preProcessing(graph& G, uint32_t& vLeft, uint32_t& vRight) {
+void preProcessing(graph& G, uint32_t& vLeft, uint32_t& vRight, std::vector<uint32_t>& newID) {
 
     // Filtering out nodes not in a 2-core
-    Obtain2Core(G, vLeft, vRight);
+    Obtain2Core(G, vLeft, vRight, newID);
 
     // Swaps left and right sets s.t. the left set has the smaller number of nodes
-    if (vLeft > vRight) {
-        graph G2(vLeft + vRight);
+    const bool swapped = vLeft > vRight;
+    if (swapped) {
+        // right set node i becomes node i - vLeft and left set node i becomes node i + vRight
+        auto oldNode = [&](uint32_t i) {return i < vRight ? i + vLeft : i - vRight;};
+        graph G2;
+        G2.resize(vLeft + vRight, [&](uint32_t i) {return G.degree(oldNode(i));});
         tbb::parallel_for(tbb::blocked_range<uint32_t>(0, vLeft + vRight), [&](tbb::blocked_range<uint32_t> r) {
             for (uint32_t i = r.begin(); i < r.end(); ++i){
-                if (i < vLeft) {
-                    G2[i + vRight].reserve(G[i].size());
-                    for (uint32_t n : G[i])
-                        G2[i + vRight].emplace_back(n - vLeft);
+                uint32_t *out = G2[i].begin();
+                if (i < vRight) {
+                    for (uint32_t n : G[i + vLeft])
+                        *out++ = n + vRight;
                 }
                 else {
-                    G2[i - vLeft].reserve(G[i].size());
-                    for (uint32_t n : G[i])
-                        G2[i - vLeft].emplace_back(n + vRight);
+                    for (uint32_t n : G[i - vRight])
+                        *out++ = n - vLeft;
                 }
             }
         });
@@ -162,20 +206,21 @@ void preProcessing(graph& G, uint32_t& vLeft, uint32_t& vRight) {
         }
     });
 
-    graph newG(vLeft + vRight);
+    // left set node i is renamed to rank[i], so new node i is the old node idx[i]
+    graph newG;
+    newG.resize(vLeft + vRight, [&](uint32_t u) {return G.degree(u < vLeft ? idx[u] : u);});
 
     tbb::parallel_for(tbb::blocked_range<uint32_t>(0, vLeft + vRight), [&](tbb::blocked_range<uint32_t> r) {
         for (uint32_t u = r.begin(); u < r.end(); ++u) {
+            uint32_t *out = newG[u].begin();
             if (u < vLeft) {
-                newG[rank[u]].reserve(G[u].size());
-                for (uint32_t v : G[u]) {
-                    newG[rank[u]].emplace_back(v);
+                for (uint32_t v : G[idx[u]]) {
+                    *out++ = v;
                 }
             }
             else {
-                newG[u].reserve(G[u].size());
                 for (uint32_t v : G[u]) {
-                    newG[u].emplace_back(rank[v]);
+                    *out++ = rank[v];
                 }
             }
         }
@@ -188,94 +233,78 @@ void preProcessing(graph& G, uint32_t& vLeft, uint32_t& vRight) {
     });
 
     G = std::move(newG);
+
+    // Applies the side swap and the left set ranking to the 2-core IDs
+    tbb::parallel_for(tbb::blocked_range<uint32_t>(0, newID.size()), [&](tbb::blocked_range<uint32_t> r) {
+        for (uint32_t x = r.begin(); x < r.end(); ++x) {
+            uint32_t id = newID[x];
+            if (id == REMOVED_ID) continue;
+            if (swapped) {
+                id = id < vRight ? id + vLeft : id - vRight;
+            }
+            newID[x] = id < vLeft ? rank[id] : id;
+        }
+    });
 }
 
 /*
-Preprocesses the graph (G) by:
-    - Filtering out nodes not in a 2-core
-    - Swaps left and right sets s.t. the left set has the smaller number of nodes
-    - Sorts left set by increasing 2-path counts
-    - Outputs a hashmap of edges (E)
+Outputs the edge membership index (E) of each left set node of the preprocessed graph (G), 
+which has to outlive it; the hubs are numbered by a prefix sum, and their bitmaps placed in that order
 */
-void preProcessing(graph& G, uint32_t& vLeft, uint32_t& vRight, edges& E) {
+void buildEdges(const graph& G, const uint32_t vLeft, edges& E) {
+    const uint32_t vRight = G.size() - vLeft;
+    E.neighbors = G.neighbors.data();
+    E.vLeft = vLeft;
+    E.words = ((uint64_t) vRight + 63) / 64;
+    E.rows.resize(vLeft);
 
-    // Filtering out nodes not in a 2-core
-    Obtain2Core(G, vLeft, vRight);
+    const uint64_t hub = hubDegree(vRight);
+    auto dense = [&](uint32_t u) {return G.degree(u) >= hub;};
 
-    // Swaps left and right sets s.t. the left set has the smaller number of nodes
-    if (vLeft > vRight) {
-        graph G2(vLeft + vRight);
-        tbb::parallel_for(tbb::blocked_range<uint32_t>(0, vLeft + vRight), [&](tbb::blocked_range<uint32_t> r) {
-            for (uint32_t i = r.begin(); i < r.end(); ++i){
-                if (i < vLeft) {
-                    G2[i + vRight].reserve(G[i].size());
-                    for (uint32_t n : G[i])
-                        G2[i + vRight].emplace_back(n - vLeft);
-                }
-                else {
-                    G2[i - vLeft].reserve(G[i].size());
-                    for (uint32_t n : G[i])
-                        G2[i - vLeft].emplace_back(n + vRight);
-                }
-            }
-        });
-        std::swap(vLeft, vRight);
-        G = std::move(G2);
-    }
+    const uint32_t numHubs = tbb::parallel_scan(tbb::blocked_range<uint32_t>(0, vLeft), (uint32_t) 0,
+		[&](tbb::blocked_range<uint32_t> r, uint32_t sum, bool is_final_scan) {
+			uint32_t tmp = sum;
+			for (uint32_t u = r.begin(); u < r.end(); ++u) {
+				if (is_final_scan) {
+					E.rows[u] = {G.offsets[u], (uint32_t) G.degree(u), dense(u) ? tmp + 1 : 0};
+				}
+                tmp += dense(u);
+			}
+			return tmp;
+		},
+		[](uint32_t a, uint32_t b) {
+			return a + b;
+	    }
+    );
 
-    // Sorts left set by increasing 2-path counts
-    std::vector<uint32_t> idx(vLeft);
-    std::vector<uint64_t> path2Cnts(vLeft);
+    E.bits.assign(numHubs * E.words, 0);
 
     tbb::parallel_for(tbb::blocked_range<uint32_t>(0, vLeft), [&](tbb::blocked_range<uint32_t> r) {
-        for (uint32_t i = r.begin(); i < r.end(); ++i){
-            idx[i] = i;
-            const uint32_t v_size = G[i].size();
-            uint64_t count = 0;
-            #pragma omp simd reduction(+:count)
-            for (uint32_t idx = 0; idx < v_size; ++idx)
-                count += (uint64_t) G[G[i][idx]].size() - 1;
-            path2Cnts[i] = count;
+        for (uint32_t u = r.begin(); u < r.end(); ++u) {
+            uint64_t *bitmap = (uint64_t *) E.bitmap(u);
+            if (bitmap == NULL) continue;
+            for (uint32_t v : G[u]) {
+                bitmap[(v - vLeft) >> 6] |= (uint64_t) 1 << ((v - vLeft) & 63);
+            }
         }
     });
+}
 
-    tbb::parallel_sort(idx.begin(), idx.end(), [&path2Cnts](uint32_t i1, uint32_t i2) {return path2Cnts[i1] < path2Cnts[i2];});
-
-    std::vector<uint32_t> rank(vLeft);
+/*
+Splits the neighbor list of each neighbor y of every left set node x of the preprocessed graph (G) 
+into the neighbors ranked above and below x (G.splits), so the algorithms iterate exact ranges
+The lists are sorted in descending order, so each split is found by a binary search
+*/
+void orientGraph(graph& G, const uint32_t vLeft) {
+    G.splits.resize(G.offsets[vLeft]);
 
     tbb::parallel_for(tbb::blocked_range<uint32_t>(0, vLeft), [&](tbb::blocked_range<uint32_t> r) {
-        for (uint32_t i = r.begin(); i < r.end(); ++i){
-            rank[idx[i]] = i;
-        }
-    });
-
-    graph newG(vLeft + vRight);
-    E.resize(vLeft);
-
-    tbb::parallel_for(tbb::blocked_range<uint32_t>(0, vLeft + vRight), [&](tbb::blocked_range<uint32_t> r) {
-        for (uint32_t u = r.begin(); u < r.end(); ++u) {
-            if (u < vLeft) {
-                newG[rank[u]].reserve(G[u].size());
-                E[rank[u]].reserve(G[u].size());
-                for (uint32_t v : G[u]) {
-                    newG[rank[u]].emplace_back(v);
-                    E[rank[u]].emplace(v);
-                }
-            }
-            else {
-                newG[u].reserve(G[u].size());
-                for (uint32_t v : G[u]) {
-                    newG[u].emplace_back(rank[v]);
-                }
+        for (uint32_t x = r.begin(); x < r.end(); ++x) {
+            for (uint64_t e = G.offsets[x]; e < G.offsets[x + 1]; ++e) {
+                const uint32_t *row = G.neighbors.data() + G.offsets[G.neighbors[e]];
+                const uint32_t *rowEnd = G.neighbors.data() + G.offsets[G.neighbors[e] + 1];
+                G.splits[e] = std::partition_point(row, rowEnd, [x](uint32_t z) {return z > x;}) - row;
             }
         }
     });
-
-    tbb::parallel_for(tbb::blocked_range<uint32_t>(0, vLeft + vRight), [&](tbb::blocked_range<uint32_t> r) {
-        for (uint32_t i = r.begin(); i < r.end(); ++i){
-            std::sort(newG[i].begin(), newG[i].end(), std::greater<uint32_t>());
-        }
-    });
-
-    G = std::move(newG);
 }
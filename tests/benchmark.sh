@@ -0,0 +1,33 @@
+#!/bin/bash
+# Runs each algorithm (runs) times on a dataset and prints its count and the fastest and slowest of its times,
+# which is how the timings in the README were taken; PAR6CYCLE_* variables set by the caller apply to every run
+#
+#   [PAR6CYCLE_...=...] ./benchmark.sh <directory holding the algorithms> <path_to_dataset> [runs] [algorithms] [partition_size]
+#
+# e.g. comparing BTJ with and without compression over three runs:
+#   ./benchmark.sh build graph.txt 3 BTJ
+#   PAR6CYCLE_COMPRESS=1 ./benchmark.sh build graph.txt 3 BTJ
+
+if [ $# -lt 2 ]; then
+    echo "Usage: $0 <directory holding the algorithms> <path_to_dataset> [runs] [algorithms] [partition_size]"
+    exit 1
+fi
+
+BIN=$1
+DATASET=$2
+RUNS=${3:-3}
+ALGORITHMS=${4:-"NJ WJ TJ BTJ"}
+PARTITION=$5
+
+env | grep ^PAR6CYCLE_ | sort
+for algorithm in $ALGORITHMS; do
+    count=""
+    times=()
+    for ((run = 0; run < RUNS; ++run)); do
+        output=$("$BIN/$algorithm" "$DATASET" $([ $algorithm = BTJ ] && echo $PARTITION))
+        count=$(sed -n 's/^Number of induced 6 cycles: //p' <<< "$output")
+        times+=($(sed -n 's/^Elapsed time = \([0-9]*\) milliseconds/\1/p' <<< "$output"))
+    done
+    sorted=($(printf '%s\n' "${times[@]}" | sort -n))
+    echo "$algorithm: ${count:-no count} cycles, ${sorted[0]}-${sorted[-1]} ms over $RUNS runs"
+done
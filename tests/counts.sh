@@ -0,0 +1,115 @@
+#!/bin/bash
+# Checks the number of induced 6-cycles every algorithm counts on graph.txt under each PAR6CYCLE_* mode
+# and for each way of reading the graph (snapshot, cache, gzip, standard input, shards)
+#
+#   ./counts.sh <directory holding NJ, WJ, TJ, BTJ and convert>
+
+BIN=$(cd "$1" && pwd)
+GRAPH=$(cd "$(dirname "$0")" && pwd)/graph.txt
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK"
+
+# graph.txt has 700 distinct edges and 40 duplicates; SIMPLE is the count without the duplicates,
+# DUPLICATES the count of each algorithm when they are kept, which is what the original code counted
+SIMPLE=38481
+declare -A DUPLICATES=([NJ]=50461 [WJ]=54191 [TJ]=54191 [BTJ]=979252629846)
+ALGORITHMS="NJ WJ TJ BTJ"
+
+failures=0
+checks=0
+
+# runs <algorithm> <arguments...> with the variables of <environment> and compares its count to <expected>
+check() {
+    local environment=$1 expected=$2 algorithm=$3
+    shift 3
+    local output count
+    output=$(env $environment "$BIN/$algorithm" "$@" 2>&1 < "${STDIN:-/dev/null}")
+    count=$(sed -n 's/^Number of induced 6 cycles: //p' <<< "$output")
+    checks=$((checks + 1))
+    if [ "$count" != "$expected" ]; then
+        echo "FAIL: $environment $algorithm $*: expected $expected, counted ${count:-nothing}"
+        sed 's/^/    /' <<< "$output" | tail -5
+        failures=$((failures + 1))
+    fi
+}
+
+# checks every algorithm on <input> with and without the duplicate edges, under <environment>
+checkAll() {
+    local environment=$1 input=$2
+    for algorithm in $ALGORITHMS; do
+        check "$environment" $SIMPLE $algorithm "$input"
+        check "$environment PAR6CYCLE_NORMALIZE=0" ${DUPLICATES[$algorithm]} $algorithm "$input"
+    done
+}
+
+checkAll "" "$GRAPH"
+
+# BTJ's modes, some of which fall back to others with duplicate edges
+for kernel in scalar sse4.2 avx2 avx512; do
+    if env PAR6CYCLE_SIMD=$kernel "$BIN/BTJ" "$GRAPH" | grep -q "is not supported"; then
+        echo "skipping PAR6CYCLE_SIMD=$kernel, which this CPU does not support"
+        continue
+    fi
+    checkAll "PAR6CYCLE_SIMD=$kernel" "$GRAPH"
+done
+for triples in pairs marker auto; do
+    check "PAR6CYCLE_TRIPLES=$triples" $SIMPLE BTJ "$GRAPH"
+    check "PAR6CYCLE_TRIPLES=$triples PAR6CYCLE_NORMALIZE=0" ${DUPLICATES[BTJ]} BTJ "$GRAPH"
+done
+check "PAR6CYCLE_COMPRESS=1" $SIMPLE BTJ "$GRAPH"
+check "PAR6CYCLE_COMPRESS=1 PAR6CYCLE_NORMALIZE=0" ${DUPLICATES[BTJ]} BTJ "$GRAPH"
+for size in 1 7 1000; do
+    check "" $SIMPLE BTJ "$GRAPH" $size
+    check "PAR6CYCLE_COMPRESS=1" $SIMPLE BTJ "$GRAPH" $size
+done
+
+# modes that change how the count is made, but never the count
+for environment in PAR6CYCLE_HUB_DEGREE=1 PAR6CYCLE_HUB_DEGREE=1000000 PAR6CYCLE_TUNE=1 \
+                   PAR6CYCLE_HUGEPAGES=0 PAR6CYCLE_HUGEPAGES=hugetlb PAR6CYCLE_NUMA=1 PAR6CYCLE_NUMA=partition \
+                   PAR6CYCLE_VERBOSE=1; do
+    checkAll "$environment" "$GRAPH"
+done
+# remapping renumbers the nodes, which the counts with duplicate edges depend on through the ranking
+for remap in 1 string; do
+    for algorithm in $ALGORITHMS; do
+        check "PAR6CYCLE_REMAP=$remap" $SIMPLE $algorithm "$GRAPH"
+    done
+done
+
+# the cache is written by the first run and loaded by the second, separately with and without duplicates
+cp "$GRAPH" cached.txt
+for algorithm in $ALGORITHMS; do
+    for normalize in 1 0; do
+        expected=$([ $normalize = 1 ] && echo $SIMPLE || echo ${DUPLICATES[$algorithm]})
+        check "PAR6CYCLE_CACHE=1 PAR6CYCLE_NORMALIZE=$normalize" $expected $algorithm cached.txt
+        if ! env PAR6CYCLE_CACHE=1 PAR6CYCLE_NORMALIZE=$normalize "$BIN/$algorithm" cached.txt | grep -q "Loaded preprocessed graph"; then
+            echo "FAIL: $algorithm did not load the cache with PAR6CYCLE_NORMALIZE=$normalize"
+            failures=$((failures + 1))
+        fi
+        check "PAR6CYCLE_CACHE=1 PAR6CYCLE_NORMALIZE=$normalize" $expected $algorithm cached.txt
+    done
+done
+
+# snapshots keep the duplicates only if they are converted with PAR6CYCLE_NORMALIZE=0
+"$BIN/convert" "$GRAPH" graph.csr > /dev/null
+PAR6CYCLE_NORMALIZE=0 "$BIN/convert" "$GRAPH" duplicates.csr > /dev/null
+for algorithm in $ALGORITHMS; do
+    check "" $SIMPLE $algorithm graph.csr
+    check "PAR6CYCLE_NORMALIZE=0" ${DUPLICATES[$algorithm]} $algorithm duplicates.csr
+done
+check "PAR6CYCLE_COMPRESS=1" $SIMPLE BTJ graph.csr
+
+# other ways of reading the same edge list
+gzip -c "$GRAPH" > graph.txt.gz
+checkAll "" graph.txt.gz
+STDIN=$GRAPH checkAll "" -
+mkdir shards
+head -n 1 "$GRAPH" > shards/_header
+tail -n +2 "$GRAPH" > edges.txt
+split -n l/4 -d edges.txt shards/part-
+checkAll "" shards
+checkAll "" "shards/part-*"
+
+echo "$((checks - failures)) of $checks counts matched"
+[ $failures = 0 ]
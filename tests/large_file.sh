@@ -0,0 +1,40 @@
+#!/bin/bash
+# Checks that every algorithm counts the same induced 6-cycles on graph.txt and on a copy of it over 4 GiB,
+# whose second half of edges starts past the 4 GiB offset
+#
+#   ./large_file.sh <directory holding NJ, WJ, TJ and BTJ>
+#
+# The copy is a sparse file, so it takes no disk space: the edges are split by a comment line that holds
+# 4.5 GB of zero bytes, which are skipped like any other comment. The line starts with 8 KB of spaces,
+# so the first bytes of the file, from which its format is sniffed, are text
+
+BIN=$(cd "$1" && pwd)
+GRAPH=$(cd "$(dirname "$0")" && pwd)/graph.txt
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+half=$((($(wc -l < "$GRAPH") + 1) / 2))
+head -n $half "$GRAPH" > "$WORK/large.txt"
+printf '#%8191s' '' >> "$WORK/large.txt"
+truncate -s +4500000000 "$WORK/large.txt" || exit 1
+printf '\n' >> "$WORK/large.txt"
+tail -n +$((half + 1)) "$GRAPH" >> "$WORK/large.txt"
+
+size=$(stat -c %s "$WORK/large.txt")
+if [ $size -le 4294967296 ]; then
+    echo "FAIL: the copy has only $size bytes"
+    exit 1
+fi
+
+failures=0
+for algorithm in NJ WJ TJ BTJ; do
+    expected=$("$BIN/$algorithm" "$GRAPH" | sed -n 's/^Number of induced 6 cycles: //p')
+    count=$("$BIN/$algorithm" "$WORK/large.txt" | sed -n 's/^Number of induced 6 cycles: //p')
+    if [ -z "$expected" ] || [ "$count" != "$expected" ]; then
+        echo "FAIL: $algorithm counted ${count:-nothing} on the $size byte copy and ${expected:-nothing} on graph.txt"
+        failures=$((failures + 1))
+    else
+        echo "$algorithm counted $count on both the $size byte copy and graph.txt"
+    fi
+done
+[ $failures = 0 ]
@@ -4,25 +4,25 @@
 
 #include "main.h"
 
-// reads graph file and converts to adjacency list
-graph readGraph(const char *filename, uint32_t& nEdge, uint32_t& vLeft, uint32_t& vRight) {
+// size of the pieces the edge list is split into for parallel parsing
+const uint64_t CHUNK_SIZE = 1 << 22;
 
-    char *f;
-    uint32_t size;
-    struct stat s;
-    int fd = open (filename, O_RDONLY);
+// size of the blocks a streamed edge list is cut into; the pipeline holds a bounded number of them
+const uint64_t BLOCK_SIZE = 1 << 22;
 
-    /* Get the size of the file. */
-    fstat (fd, &s);
-    size = s.st_size;
+// size of the reads from a compressed file
+const uint64_t READ_SIZE = 1 << 20;
 
-    f = (char *) mmap (0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+// maximum number of node ranges the edges are partitioned into when building the graph
+const uint32_t MAX_BUCKETS = 4096;
 
-    int headerEnd = 0;
+// parses the "|E| |U| |V|" header line of the default edge list format and returns the offset of the first edge line
+uint64_t parseHeader(const char *f, uint64_t size, uint64_t& nEdge, uint32_t& vLeft, uint32_t& vRight) {
+    uint64_t headerEnd = 0;
     nEdge = 0, vLeft = 0, vRight = 0;
     bool nE = true, vL = false;
-    char c = f[headerEnd];
-    while (c != '\n') {
+    while (headerEnd < size && f[headerEnd] != '\n') {
+        char c = f[headerEnd];
         if (isdigit(c)) {
             if (nE) {
                 nEdge = nEdge * 10 + c - '0';
@@ -44,40 +44,1868 @@ graph readGraph(const char *filename, uint32_t& nEdge, uint32_t& vLeft, uint32_t
             }
         }
         headerEnd += 1;
-        c = f[headerEnd];
     }
+    return std::min(headerEnd + 1, size);
+}
 
-    graph G(vLeft + vRight);
+// parses a text header line of the form "<a> <b> <c>" into its three numbers, if present
+bool parseCounts(const char *line, const char *end, uint64_t counts[3]) {
+    counts[0] = counts[1] = counts[2] = 0;
+    int found = 0;
+    const char *p = line;
+    while (p < end && *p != '\n' && found < 3) {
+        if (isdigit(*p)) {
+            while (p < end && isdigit(*p)) {
+                counts[found] = counts[found] * 10 + *p - '0';
+                ++p;
+            }
+            ++found;
+        }
+        else {
+            ++p;
+        }
+    }
+    return found == 3;
+}
 
-    uint32_t u = 0, v = 0;
-    bool left = true;
-    for (uint32_t i = headerEnd + 1; i < size; ++i) {
-        c = f[i];
+// returns the offset of the line after the one containing (pos)
+uint64_t nextLine(const char *f, uint64_t size, uint64_t pos) {
+    while (pos < size && f[pos] != '\n') ++pos;
+    return std::min(pos + 1, size);
+}
 
-        if (isdigit(c)) {
-            if (left) {
-                u = u * 10 + c - '0';
+/*
+Parses the KONECT header and returns the offset of the first edge line
+KONECT files start with "% bip <weights>" and usually "% |E| |U| |V|"; 
+the counts are left at 0 if the second line is missing
+*/
+uint64_t parseKonectHeader(const char *f, uint64_t size, uint64_t& nEdge, uint32_t& vLeft, uint32_t& vRight) {
+    nEdge = 0, vLeft = 0, vRight = 0;
+    uint64_t pos = 0;
+    uint64_t counts[3];
+    while (pos < size && f[pos] == '%') {
+        if (parseCounts(f + pos, f + size, counts)) {
+            nEdge = counts[0], vLeft = counts[1], vRight = counts[2];
+        }
+        pos = nextLine(f, size, pos);
+    }
+    return pos;
+}
+
+/*
+Parses the MatrixMarket banner, comments and "rows columns entries" size line 
+and returns the offset of the first entry; rows are the left set and columns the right set
+*/
+uint64_t parseMatrixMarketHeader(const char *f, uint64_t size, uint64_t& nEdge, uint32_t& vLeft, uint32_t& vRight) {
+    const uint64_t bannerEnd = nextLine(f, size, 0);
+    if (std::string(f, bannerEnd).find("coordinate") == std::string::npos) {
+        std::cout << "Error: only MatrixMarket coordinate files are supported" << std::endl;
+        exit(1);
+    }
+    uint64_t pos = bannerEnd;
+    while (pos < size && f[pos] == '%') {
+        pos = nextLine(f, size, pos);
+    }
+    uint64_t counts[3];
+    if (!parseCounts(f + pos, f + size, counts)) {
+        std::cout << "Error: missing MatrixMarket size line" << std::endl;
+        exit(1);
+    }
+    vLeft = counts[0], vRight = counts[1], nEdge = counts[2];
+    return nextLine(f, size, pos);
+}
+
+// binary pairs have no header; the counts are derived from the edges
+uint64_t parseNoHeader(const char * /*f*/, uint64_t /*size*/, uint64_t& nEdge, uint32_t& vLeft, uint32_t& vRight) {
+    nEdge = 0, vLeft = 0, vRight = 0;
+    return 0;
+}
+
+/*
+Parses the lines in [begin, end) as "u v" edges with IDs starting at (base) and appends them to E
+Separators may be spaces, tabs or commas; further columns (e.g. weights) and 
+lines starting with anything other than a digit (e.g. '%' or '#' comments) are ignored
+IDs are read into 64 bits, and those that do not fit 32 bits (or are below base) become UINT32_MAX, 
+which is out of range for every graph, so buildGraph skips and reports their edges
+*/
+inline void parseLines(const char *begin, const char *end, const uint32_t base, edgeList& E) {
+    auto digit = [](char c) {return (unsigned char) (c - '0') < 10;};
+    auto separator = [](char c) {return c == ' ' || c == '\t' || c == ',';};
+    // digits past UINT32_MAX are not accumulated, so longer IDs cannot wrap around
+    auto parseID = [&](const char *&p) {
+        uint64_t x = 0;
+        while (p < end && digit(*p)) {
+            if (x <= UINT32_MAX) x = x * 10 + (*p - '0');
+            ++p;
+        }
+        return x - base > UINT32_MAX ? UINT32_MAX : (uint32_t) (x - base);
+    };
+    const char *p = begin;
+    while (p < end) {
+        while (p < end && separator(*p)) ++p;
+        if (p < end && digit(*p)) {
+            const uint32_t u = parseID(p);
+            while (p < end && separator(*p)) ++p;
+            if (p < end && digit(*p)) {
+                const uint32_t v = parseID(p);
+                E.emplace_back(u, v);
             }
-            else {
-                v = v * 10 + c - '0';
+        }
+        // skip the rest of the line
+        while (p < end && *p != '\n') ++p;
+        ++p;
+    }
+}
+
+void parseZeroBasedLines(const char *begin, const char *end, edgeList& E) {parseLines(begin, end, 0, E);}
+
+void parseOneBasedLines(const char *begin, const char *end, edgeList& E) {parseLines(begin, end, 1, E);}
+
+// appends the little-endian uint32_t (u, v) pairs in [begin, end) to E without parsing
+void copyPairs(const char *begin, const char *end, edgeList& E) {
+    const uint64_t numPairs = (end - begin) / sizeof(std::pair<uint32_t, uint32_t>);
+    const uint64_t oldSize = E.size();
+    E.resize(oldSize + numPairs);
+    memcpy((void *) (E.data() + oldSize), begin, numPairs * sizeof(std::pair<uint32_t, uint32_t>));
+}
+
+// length of the longest prefix of [f, f + size) made of complete lines
+uint64_t completeLines(const char *f, uint64_t size) {
+    while (size > 0 && f[size - 1] != '\n') --size;
+    return size;
+}
+
+// length of the longest prefix of [f, f + size) made of complete pairs
+uint64_t completePairs(const char * /*f*/, uint64_t size) {
+    return size - size % sizeof(std::pair<uint32_t, uint32_t>);
+}
+
+bool sniffMatrixMarket(const char *f, uint64_t size) {
+    return size >= 14 && memcmp(f, "%%MatrixMarket", 14) == 0;
+}
+
+bool sniffKonect(const char *f, uint64_t size) {
+    return size >= 1 && f[0] == '%';
+}
+
+// text files only contain printable characters and whitespace
+bool sniffText(const char *f, uint64_t size) {
+    for (uint64_t i = 0; i < std::min(size, (uint64_t) 4096); ++i) {
+        const unsigned char c = f[i];
+        if ((c < 32 || c > 126) && c != '\n' && c != '\r' && c != '\t') {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool sniffAny(const char * /*f*/, uint64_t /*size*/) {
+    return true;
+}
+
+// supported edge list formats, in the order they are tried when sniffing an input
+const edgeListFormat FORMATS[] = {
+    {"MatrixMarket", true, sniffMatrixMarket, parseMatrixMarketHeader, parseOneBasedLines, completeLines},
+    {"KONECT", true, sniffKonect, parseKonectHeader, parseOneBasedLines, completeLines},
+    {"edge list", true, sniffText, parseHeader, parseZeroBasedLines, completeLines},
+    {"binary pairs", false, sniffAny, parseNoHeader, copyPairs, completePairs},
+};
+
+// returns the first format that accepts the (size) bytes at the start of the input (f)
+const edgeListFormat& sniffFormat(const char *f, uint64_t size) {
+    for (const edgeListFormat& format : FORMATS) {
+        if (format.sniff(f, size)) {
+            return format;
+        }
+    }
+    return FORMATS[3];
+}
+
+// reads up to n bytes into dst and returns how many were read, 0 at the end of the input or a negative value on errors
+typedef std::function<int64_t(char *dst, uint64_t n)> byteSource;
+
+// parses the records in [begin, end) into a chunk of edges (an edgeList or a keyChunk)
+template <typename Chunk>
+using chunkParser = void (*)(const char *begin, const char *end, Chunk& C);
+
+chunkParser<edgeList> edgeParser(const edgeListFormat& format) {
+    return format.parseEdges;
+}
+
+/*
+Edges of one chunk of a remapped input as the identifiers of their endpoints: 
+keys[2 * i] is the left and keys[2 * i + 1] the right identifier of edge i
+Numeric identifiers are stored as they are; string identifiers are appended to (text) 
+and their keys are the offsets of their ends in (text)
+*/
+struct keyChunk {
+    std::vector<uint64_t> keys;
+    std::string text;
+};
+
+inline bool isSeparator(char c) {return c == ' ' || c == '\t' || c == ',' || c == '\r';}
+
+/*
+Parses the lines in [begin, end) as "u v" edges with arbitrary 64-bit numeric identifiers
+Like parseLines, further columns and lines not starting with a digit are ignored
+*/
+void parseNumericLines(const char *begin, const char *end, keyChunk& C) {
+    auto digit = [](char c) {return (unsigned char) (c - '0') < 10;};
+    const char *p = begin;
+    while (p < end) {
+        while (p < end && isSeparator(*p)) ++p;
+        if (p < end && digit(*p)) {
+            uint64_t u = 0;
+            while (p < end && digit(*p)) u = u * 10 + (*p++ - '0');
+            while (p < end && isSeparator(*p)) ++p;
+            if (p < end && digit(*p)) {
+                uint64_t v = 0;
+                while (p < end && digit(*p)) v = v * 10 + (*p++ - '0');
+                C.keys.push_back(u);
+                C.keys.push_back(v);
             }
         }
-        else {
-            if (c == ' ') {
-                left = false;
+        // skip the rest of the line
+        while (p < end && *p != '\n') ++p;
+        ++p;
+    }
+}
+
+/*
+Parses the lines in [begin, end) as "u v" edges whose identifiers are 
+the first two fields of every line not starting with '%' or '#'
+*/
+void parseStringLines(const char *begin, const char *end, keyChunk& C) {
+    const char *p = begin;
+    while (p < end) {
+        while (p < end && isSeparator(*p)) ++p;
+        const char *u = p;
+        while (p < end && !isSeparator(*p) && *p != '\n') ++p;
+        const char *uEnd = p;
+        while (p < end && isSeparator(*p)) ++p;
+        const char *v = p;
+        while (p < end && !isSeparator(*p) && *p != '\n') ++p;
+        if (u < uEnd && v < p && *u != '%' && *u != '#') {
+            C.text.append(u, uEnd);
+            C.keys.push_back(C.text.size());
+            C.text.append(v, p);
+            C.keys.push_back(C.text.size());
+        }
+        // skip the rest of the line
+        while (p < end && *p != '\n') ++p;
+        ++p;
+    }
+}
+
+// reads the little-endian uint32_t (u, v) pairs in [begin, end) as numeric identifiers
+void copyNumericPairs(const char *begin, const char *end, keyChunk& C) {
+    const char *last = begin + completePairs(begin, end - begin);
+    for (const char *p = begin; p < last; p += sizeof(uint32_t)) {
+        uint32_t x;
+        memcpy(&x, p, sizeof(x));
+        C.keys.push_back(x);
+    }
+}
+
+// reads the little-endian uint32_t (u, v) pairs in [begin, end) as string identifiers
+void copyStringPairs(const char *begin, const char *end, keyChunk& C) {
+    const char *last = begin + completePairs(begin, end - begin);
+    for (const char *p = begin; p < last; p += sizeof(uint32_t)) {
+        uint32_t x;
+        memcpy(&x, p, sizeof(x));
+        C.text += std::to_string(x);
+        C.keys.push_back(C.text.size());
+    }
+}
+
+chunkParser<keyChunk> numericParser(const edgeListFormat& format) {
+    return format.text ? parseNumericLines : copyNumericPairs;
+}
+
+chunkParser<keyChunk> stringParser(const edgeListFormat& format) {
+    return format.text ? parseStringLines : copyStringPairs;
+}
+
+// returns the (i)th identifier of (C) as a 64-bit integer or a view of its text
+template <typename Key>
+inline Key keyAt(const keyChunk& C, uint64_t i) {
+    if constexpr (std::is_same<Key, uint64_t>::value) {
+        return C.keys[i];
+    }
+    else {
+        const uint64_t begin = i == 0 ? 0 : C.keys[i - 1];
+        return std::string_view(C.text.data() + begin, C.keys[i] - begin);
+    }
+}
+
+inline void reserveEdges(edgeList& E, uint64_t n) {E.reserve(n);}
+
+inline void reserveEdges(keyChunk& C, uint64_t n) {C.keys.reserve(2 * n);}
+
+// the records [begin, end) of a file mapped at (f)
+struct mappedRange {
+    const char *f;
+    uint64_t begin;
+    uint64_t end;
+};
+
+/*
+Splits every range of (ranges) into chunks at record boundaries 
+and parses the chunks of all ranges in parallel, each into its own edge buffer
+*/
+template <typename Chunk>
+std::vector<Chunk> parseEdgesParallel(const std::vector<mappedRange>& ranges, const edgeListFormat& format, chunkParser<Chunk> parse) {
+    // chunkStart[k] = index of the first chunk of range k
+    std::vector<uint64_t> chunkStart(ranges.size() + 1);
+    for (size_t k = 0; k < ranges.size(); ++k) {
+        chunkStart[k + 1] = chunkStart[k] + (ranges[k].end - ranges[k].begin + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    }
+    const uint64_t numChunks = chunkStart.back();
+    std::vector<Chunk> buffers(numChunks);
+
+    /*
+    Moves the nominal start of every chunk back to the end of the last complete record, searching 
+    no further back than the nominal start of the previous chunk of its range, so a record longer 
+    than CHUNK_SIZE is not scanned again for every chunk it spans: a chunk that finds no end of a 
+    record inside such a record starts where the previous one does, and stays empty
+    */
+    std::vector<uint64_t> starts(numChunks);
+    tbb::parallel_for(tbb::blocked_range<uint64_t>(0, numChunks, 1), [&](tbb::blocked_range<uint64_t> r) {
+        for (uint64_t i = r.begin(); i < r.end(); ++i) {
+            const size_t k = std::upper_bound(chunkStart.begin(), chunkStart.end(), i) - chunkStart.begin() - 1;
+            const mappedRange& range = ranges[k];
+            if (i == chunkStart[k]) {
+                starts[i] = range.begin;
+                continue;
+            }
+            const uint64_t from = range.begin + (i - chunkStart[k] - 1) * CHUNK_SIZE;
+            const uint64_t complete = format.completeRecords(range.f + from, CHUNK_SIZE);
+            starts[i] = complete == 0 ? UINT64_MAX : from + complete;
+        }
+    });
+    for (uint64_t i = 0; i < numChunks; ++i) {
+        if (starts[i] == UINT64_MAX) starts[i] = starts[i - 1];
+    }
+
+    tbb::parallel_for(tbb::blocked_range<uint64_t>(0, numChunks, 1), [&](tbb::blocked_range<uint64_t> r) {
+        for (uint64_t i = r.begin(); i < r.end(); ++i) {
+            const size_t k = std::upper_bound(chunkStart.begin(), chunkStart.end(), i) - chunkStart.begin() - 1;
+            const mappedRange& range = ranges[k];
+            const uint64_t chunkBegin = starts[i];
+            const uint64_t chunkEnd = i + 1 < chunkStart[k + 1] ? starts[i + 1] : range.end;
+            // a chunk only outgrows CHUNK_SIZE by a long record, which holds at most one edge
+            reserveEdges(buffers[i], std::min(chunkEnd - chunkBegin, CHUNK_SIZE) / 8);
+            parse(range.f + chunkBegin, range.f + chunkEnd, buffers[i]);
+        }
+    });
+
+    return buffers;
+}
+
+// fills in the counts a format's header did not provide from the parsed edges
+void completeCounts(const std::vector<edgeList>& buffers, uint64_t& nEdge, uint32_t& vLeft, uint32_t& vRight) {
+    if (nEdge == 0) {
+        for (const edgeList& E : buffers) {
+            nEdge += E.size();
+        }
+    }
+    if (vLeft == 0 && vRight == 0) {
+        std::pair<uint32_t, uint32_t> bounds = tbb::parallel_reduce(tbb::blocked_range<size_t>(0, buffers.size(), 1), std::make_pair(0u, 0u),
+            [&](tbb::blocked_range<size_t> r, std::pair<uint32_t, uint32_t> b) {
+                for (size_t i = r.begin(); i < r.end(); ++i) {
+                    for (const std::pair<uint32_t, uint32_t>& e : buffers[i]) {
+                        b.first = std::max(b.first, e.first + 1);
+                        b.second = std::max(b.second, e.second + 1);
+                    }
+                }
+                return b;
+            },
+            [](std::pair<uint32_t, uint32_t> a, std::pair<uint32_t, uint32_t> b) {
+                return std::make_pair(std::max(a.first, b.first), std::max(a.second, b.second));
+            }
+        );
+        vLeft = bounds.first;
+        vRight = bounds.second;
+    }
+}
+
+/*
+Parallel hash map from original identifiers to dense IDs
+Every submap (shard) is filled by a single thread, so no locks are taken
+*/
+template <typename Key>
+class idTable : public phmap::parallel_flat_hash_map<Key, uint32_t, phmap::priv::hash_default_hash<Key>, phmap::priv::hash_default_eq<Key>,
+                                                      phmap::priv::Allocator<std::pair<const Key, uint32_t>>, 8> {
+public:
+    static size_t numShards() {return idTable::subcnt();}
+
+    static size_t shard(size_t hashval) {return idTable::subidx(hashval);}
+
+    // inserts (key) with ID (id) into its shard unless it is already present and returns the ID of (key)
+    uint32_t insert(size_t shard, const Key& key, size_t& hashval, uint32_t id) {
+        auto it = this->sets_[shard].set_.lazy_emplace_with_hash(key, hashval, [&](const auto& ctor) {ctor(key, id);});
+        return it->second;
+    }
+};
+
+/*
+Replaces the identifiers of the edges of (chunks) with dense 0-based IDs, 
+numbering the left and right sets separately, and returns the resulting edge buffers:
+    - Sorts the identifiers of each chunk by side and by the shard of the ID table they hash to
+    - Inserts the identifiers of each (side, shard) bucket in chunk order, numbering the new ones 
+      from 0 within the bucket; a shard is small enough to stay in cache while it is filled
+    - Offsets every bucket's IDs by the number of identifiers in the buckets of the same side before it
+Chunks and buckets are processed in parallel; the IDs only depend on how the input was split into chunks
+The identifier of every dense ID is stored in (leftKeys) and (rightKeys)
+*/
+template <typename Key, typename Name>
+std::vector<edgeList> remapIDs(std::vector<keyChunk>& chunks, uint64_t& nEdge, uint32_t& vLeft, uint32_t& vRight, 
+                               std::vector<Name>& leftKeys, std::vector<Name>& rightKeys) {
+    idTable<Key> tables[2];
+    const size_t numShards = idTable<Key>::numShards();
+    const size_t numBuckets = 2 * numShards;
+    const size_t numChunks = chunks.size();
+
+    struct entry {
+        Key key;
+        size_t hashval;
+        uint64_t index;
+    };
+    // order[c] holds chunk c's identifiers with their hashes and indices, bucket by bucket; bucket b starts at bucketStart[c][b]
+    std::vector<std::vector<entry>> order(numChunks);
+    std::vector<std::vector<uint64_t>> bucketStart(numChunks, std::vector<uint64_t>(numBuckets + 1));
+    std::vector<std::vector<uint8_t>> shardOf(numChunks);
+    std::vector<edgeList> buffers(numChunks);
+
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, numChunks, 1), [&](tbb::blocked_range<size_t> r) {
+        for (size_t c = r.begin(); c < r.end(); ++c) {
+            const uint64_t numKeys = chunks[c].keys.size();
+            std::vector<uint64_t>& start = bucketStart[c];
+            std::vector<size_t> hashval(numKeys);
+            shardOf[c].resize(numKeys);
+            for (uint64_t i = 0; i < numKeys; ++i) {
+                hashval[i] = tables[0].hash(keyAt<Key>(chunks[c], i));
+                shardOf[c][i] = idTable<Key>::shard(hashval[i]);
+                ++start[(i & 1) * numShards + shardOf[c][i] + 1];
+            }
+            for (size_t b = 0; b < numBuckets; ++b) {
+                start[b + 1] += start[b];
+            }
+            std::vector<uint64_t> next(start.begin(), start.end() - 1);
+            order[c].resize(numKeys);
+            for (uint64_t i = 0; i < numKeys; ++i) {
+                order[c][next[(i & 1) * numShards + shardOf[c][i]]++] = {keyAt<Key>(chunks[c], i), hashval[i], i};
             }
-            // if edge has been processed
-            else if (!left) {
-                left = true;
-                v += vLeft;
-                G[u].emplace_back(v);
-                G[v].emplace_back(u);
-                u = 0; v = 0;
+            // string identifiers still point into the text of the chunk
+            std::vector<uint64_t>().swap(chunks[c].keys);
+            buffers[c].resize(numKeys / 2);
+        }
+    });
+
+    std::vector<uint64_t> bucketBase(numBuckets + 1);
+    std::vector<std::vector<Key>> bucketKeys(numBuckets);
+
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, numBuckets, 1), [&](tbb::blocked_range<size_t> r) {
+        for (size_t b = r.begin(); b < r.end(); ++b) {
+            const bool right = b >= numShards;
+            idTable<Key>& table = tables[right];
+            std::vector<Key>& keys = bucketKeys[b];
+            for (size_t c = 0; c < numChunks; ++c) {
+                for (uint64_t j = bucketStart[c][b]; j < bucketStart[c][b + 1]; ++j) {
+                    entry& e = order[c][j];
+                    // IDs are relative to the bucket until all buckets are numbered
+                    const uint32_t id = table.insert(b - right * numShards, e.key, e.hashval, keys.size());
+                    if (id == keys.size()) {
+                        keys.push_back(e.key);
+                    }
+                    if (right) {
+                        buffers[c][e.index / 2].second = id;
+                    }
+                    else {
+                        buffers[c][e.index / 2].first = id;
+                    }
+                }
             }
+            bucketBase[b + 1] = keys.size();
         }
+    });
+
+    for (size_t b = 0; b < numBuckets; ++b) {
+        bucketBase[b + 1] += bucketBase[b];
+    }
+    const uint64_t numLeft = bucketBase[numShards];
+    const uint64_t numRight = bucketBase[numBuckets] - numLeft;
+    if (numLeft >= UINT32_MAX || numRight >= UINT32_MAX) {
+        std::cout << "Error: more than " << UINT32_MAX - 1 << " distinct node identifiers" << std::endl;
+        exit(1);
+    }
+
+    leftKeys.resize(numLeft);
+    rightKeys.resize(numRight);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, numBuckets, 1), [&](tbb::blocked_range<size_t> r) {
+        for (size_t b = r.begin(); b < r.end(); ++b) {
+            auto out = b < numShards ? leftKeys.begin() + bucketBase[b] : rightKeys.begin() + (bucketBase[b] - numLeft);
+            for (const Key& key : bucketKeys[b]) {
+                *out++ = Name(key);
+            }
+            std::vector<Key>().swap(bucketKeys[b]);
+        }
+    });
+
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, numChunks, 1), [&](tbb::blocked_range<size_t> r) {
+        for (size_t c = r.begin(); c < r.end(); ++c) {
+            for (uint64_t i = 0; i < buffers[c].size(); ++i) {
+                buffers[c][i].first += bucketBase[shardOf[c][2 * i]];
+                buffers[c][i].second += bucketBase[numShards + shardOf[c][2 * i + 1]] - numLeft;
+            }
+            std::vector<entry>().swap(order[c]);
+            std::vector<uint8_t>().swap(shardOf[c]);
+            chunks[c] = keyChunk();
+        }
+    });
+
+    if (nEdge == 0) {
+        for (const edgeList& E : buffers) {
+            nEdge += E.size();
+        }
+    }
+    vLeft = numLeft;
+    vRight = numRight;
+    return buffers;
+}
+
+// returns whether duplicate edges are removed while loading, which PAR6CYCLE_NORMALIZE=0 turns off
+bool normalizing() {
+    const char *enabled = getenv("PAR6CYCLE_NORMALIZE");
+    return enabled == NULL || strcmp(enabled, "0") != 0;
+}
+
+// returns whether BTJ counts on a compressedGraph, which PAR6CYCLE_COMPRESS=1 turns on
+bool compressing() {
+    const char *enabled = getenv("PAR6CYCLE_COMPRESS");
+    return enabled != NULL && strcmp(enabled, "0") != 0;
+}
+
+// returns whether the algorithms print how they counted besides the count and the time, which PAR6CYCLE_VERBOSE=1 turns on
+bool verbose() {
+    const char *enabled = getenv("PAR6CYCLE_VERBOSE");
+    return enabled != NULL && strcmp(enabled, "0") != 0;
+}
+
+// returns how BTJ counts the common neighbors of its triples, selected by PAR6CYCLE_TRIPLES: "pairs", "marker", otherwise auto
+uint32_t triplesMode() {
+    const char *mode = getenv("PAR6CYCLE_TRIPLES");
+    if (mode == NULL || strcmp(mode, "auto") == 0) {
+        return TRIPLES_AUTO;
+    }
+    if (strcmp(mode, "pairs") == 0) {
+        return TRIPLES_PAIRS;
+    }
+    if (strcmp(mode, "marker") == 0) {
+        return TRIPLES_MARKER;
+    }
+    std::cout << "Error: invalid PAR6CYCLE_TRIPLES " << mode << std::endl;
+    exit(1);
+}
+
+// returns the degree from which a left set node gets a bitmap (see edges), set by PAR6CYCLE_HUB_DEGREE
+uint64_t hubDegree(const uint32_t vRight) {
+    const char *degree = getenv("PAR6CYCLE_HUB_DEGREE");
+    if (degree == NULL) {
+        return std::max(HUB_MIN_DEGREE, vRight / HUB_RATIO);
+    }
+    char *end;
+    const unsigned long long value = strtoull(degree, &end, 10);
+    if (end == degree || *end != '\0' || value == 0) {
+        std::cout << "Error: invalid PAR6CYCLE_HUB_DEGREE " << degree << std::endl;
+        exit(1);
+    }
+    return value;
+}
+
+/*
+Writes the distinct neighbors in [begin, end) to (out), which may be at or before (begin), 
+keeping the first copy of each, and returns the end of the written neighbors
+Short lists are compared pairwise; longer ones are probed in an open addressing table of at least twice 
+their length, whose slots (seen) keeps between calls and which is emptied by changing (stamp)
+*/
+uint32_t *dropDuplicates(const uint32_t *begin, const uint32_t *end, uint32_t *out, std::vector<uint64_t>& seen, uint32_t& stamp) {
+    const uint64_t size = end - begin;
+    uint32_t *kept = out;
+    if (size <= 16) {
+        for (const uint32_t *i = begin; i < end; ++i) {
+            bool repeated = false;
+            for (const uint32_t *j = out; j < kept; ++j) {
+                repeated |= *j == *i;
+            }
+            if (!repeated) {
+                *kept++ = *i;
+            }
+        }
+        return kept;
+    }
+
+    uint32_t bits = 5;
+    while (((uint64_t) 1 << bits) < 2 * size) ++bits;
+    if (seen.size() < ((uint64_t) 1 << bits)) {
+        seen.assign((uint64_t) 1 << bits, 0);
+        stamp = 0;
+    }
+    if (++stamp == 0) {
+        std::fill(seen.begin(), seen.end(), 0);
+        stamp = 1;
     }
+    const uint64_t mask = ((uint64_t) 1 << bits) - 1;
+    for (const uint32_t *i = begin; i < end; ++i) {
+        const uint64_t entry = (uint64_t) stamp << 32 | *i;
+        uint64_t slot = ((*i * 0x9e3779b97f4a7c15ULL) >> (64 - bits)) & mask;
+        while (seen[slot] >> 32 == stamp && seen[slot] != entry) {
+            slot = (slot + 1) & mask;
+        }
+        if (seen[slot] != entry) {
+            seen[slot] = entry;
+            *kept++ = *i;
+        }
+    }
+    return kept;
+}
+
+/*
+Builds the CSR graph from the per-chunk edge buffers:
+    - Counts how many edge endpoints of each group of chunks fall into each range of nodes, 
+      skipping edges whose IDs are out of range
+    - Computes where every (group, range) pair starts with a prefix sum
+    - Scatters both directions of each edge into their node range
+    - Places each node range's neighbors into one flat neighbor array 
+      after a local degree count + prefix sum
+    - If normalizing, drops every node's duplicate neighbors while the range is in cache
+    - The flat array becomes the CSR graph, compacted first if duplicates left unused range tails
+Every pass writes to disjoint locations, so no atomics are needed
+The skipped and duplicate edges are reported and not counted in (nEdge)
+*/
+graph buildGraph(std::vector<edgeList>& buffers, uint64_t& nEdge, const uint32_t vLeft, const uint32_t vRight) {
+    const uint32_t n = vLeft + vRight;
+    const bool normalize = normalizing();
+
+    // the chunks are processed in a bounded number of groups so the counts stay small for huge inputs
+    const uint64_t numChunks = buffers.size();
+    const uint64_t numGroups = std::max((uint64_t) 1, std::min(numChunks, (uint64_t) 4 * tbb::this_task_arena::max_concurrency()));
+    auto groupStart = [&](uint64_t g) {return g * numChunks / numGroups;};
+
+    uint32_t shift = 0;
+    while ((n >> shift) >= MAX_BUCKETS) ++shift;
+    const uint32_t numBuckets = (n >> shift) + 1;
+
+    // bucketStart[b * numGroups + g] = offset of the endpoints of group g in node range b
+    std::vector<uint64_t> bucketStart(numBuckets * numGroups + 1);
+    std::vector<uint64_t> outOfRange(numGroups);
+
+    tbb::parallel_for(tbb::blocked_range<uint64_t>(0, numGroups, 1), [&](tbb::blocked_range<uint64_t> r) {
+        for (uint64_t g = r.begin(); g < r.end(); ++g) {
+            for (uint64_t i = groupStart(g); i < groupStart(g + 1); ++i) {
+                for (const std::pair<uint32_t, uint32_t>& e : buffers[i]) {
+                    if (e.first >= vLeft || e.second >= vRight) {
+                        ++outOfRange[g];
+                        continue;
+                    }
+                    ++bucketStart[(e.first >> shift) * numGroups + g];
+                    ++bucketStart[((e.second + vLeft) >> shift) * numGroups + g];
+                }
+            }
+        }
+    });
+
+    tbb::parallel_scan(tbb::blocked_range<uint64_t>(0, bucketStart.size()), (uint64_t) 0,
+		[&](tbb::blocked_range<uint64_t> r, uint64_t sum, bool is_final_scan) {
+			uint64_t tmp = sum;
+			for (uint64_t j = r.begin(); j < r.end(); ++j) {
+                const uint64_t cnt = bucketStart[j];
+				if (is_final_scan) {
+					bucketStart[j] = tmp;
+				}
+                tmp += cnt;
+			}
+			return tmp;
+		},
+		[](uint64_t a, uint64_t b) {
+			return a + b;
+	    }
+    );
+
+    const uint64_t numEntries = bucketStart.back();
+    std::vector<std::pair<uint32_t, uint32_t>> staged(numEntries);
+
+    tbb::parallel_for(tbb::blocked_range<uint64_t>(0, numGroups, 1), [&](tbb::blocked_range<uint64_t> r) {
+        for (uint64_t g = r.begin(); g < r.end(); ++g) {
+            for (uint64_t i = groupStart(g); i < groupStart(g + 1); ++i) {
+                for (const std::pair<uint32_t, uint32_t>& e : buffers[i]) {
+                    if (e.first >= vLeft || e.second >= vRight) continue;
+                    const uint32_t u = e.first;
+                    const uint32_t v = e.second + vLeft;
+                    staged[bucketStart[(u >> shift) * numGroups + g]++] = std::make_pair(u, v);
+                    staged[bucketStart[(v >> shift) * numGroups + g]++] = std::make_pair(v, u);
+                }
+                edgeList().swap(buffers[i]);
+            }
+        }
+    });
+
+    // offsets[x] = offset of x's first neighbor in the flat neighbor array
+    hugeVector<uint64_t> offsets(n + 1);
+    hugeVector<uint32_t> neighbors(numEntries);
+    offsets[n] = numEntries;
+
+    // rangeEnd[b] = end of the neighbors node range b keeps; the rest of the range is unused
+    std::vector<uint64_t> rangeEnd(numBuckets);
+
+    tbb::parallel_for(tbb::blocked_range<uint32_t>(0, numBuckets, 1), [&](tbb::blocked_range<uint32_t> r) {
+        std::vector<uint64_t> seen;
+        uint32_t stamp = 0;
+        for (uint32_t b = r.begin(); b < r.end(); ++b) {
+            // after the scatter, bucketStart[b * numGroups + g] is the start of the next (group, range) pair
+            const uint64_t begin = b == 0 ? 0 : bucketStart[b * numGroups - 1];
+            const uint64_t end = bucketStart[(b + 1) * numGroups - 1];
+            const uint32_t first = b << shift;
+            const uint32_t last = std::min((uint64_t) n, (uint64_t) (b + 1) << shift);
+            rangeEnd[b] = end;
+            if (first >= last) continue;
+
+            for (uint32_t x = first; x < last; ++x) {
+                offsets[x] = 0;
+            }
+            for (uint64_t j = begin; j < end; ++j) {
+                ++offsets[staged[j].first];
+            }
+            uint64_t sum = begin;
+            for (uint32_t x = first; x < last; ++x) {
+                const uint64_t deg = offsets[x];
+                offsets[x] = sum;
+                sum += deg;
+            }
+            // offsets[x] is advanced as x's neighbors are placed and then restored
+            for (uint64_t j = begin; j < end; ++j) {
+                neighbors[offsets[staged[j].first]++] = staged[j].second;
+            }
+            for (uint32_t x = last - 1; x > first; --x) {
+                offsets[x] = offsets[x - 1];
+            }
+            offsets[first] = begin;
+
+            if (normalize) {
+                // the distinct neighbors are moved to the front of the range
+                uint32_t *kept = neighbors.data() + begin;
+                for (uint32_t x = first; x < last; ++x) {
+                    uint32_t *row = neighbors.data() + offsets[x];
+                    uint32_t *rowEnd = neighbors.data() + (x + 1 < last ? offsets[x + 1] : end);
+                    offsets[x] = kept - neighbors.data();
+                    kept = dropDuplicates(row, rowEnd, kept, seen, stamp);
+                }
+                rangeEnd[b] = kept - neighbors.data();
+            }
+        }
+    });
+
+    std::vector<std::pair<uint32_t, uint32_t>>().swap(staged);
+
+    uint64_t skipped = 0;
+    for (uint64_t count : outOfRange) {
+        skipped += count;
+    }
+    if (skipped > 0) {
+        std::cout << "Skipped " << skipped << " edges with out of range IDs" << std::endl;
+    }
+
+    uint64_t numKept = 0;
+    for (uint32_t b = 0; b < numBuckets; ++b) {
+        numKept += rangeEnd[b] - (b == 0 ? 0 : bucketStart[b * numGroups - 1]);
+    }
+    if (numKept < numEntries) {
+        std::cout << "Removed " << (numEntries - numKept) / 2 << " duplicate edges" << std::endl;
+    }
+    if (skipped > 0 || numKept < numEntries) {
+        nEdge = numKept / 2;
+    }
+
+    graph G;
+
+    if (numKept == numEntries) {
+        G.offsets = std::move(offsets);
+        G.neighbors = std::move(neighbors);
+        return G;
+    }
+
+    // the neighbors of each node are moved up over the unused tails of the node ranges before it
+    auto rowEnd = [&](uint32_t x) {
+        const bool lastInRange = x + 1 == n || (x + 1) >> shift != x >> shift;
+        return lastInRange ? rangeEnd[x >> shift] : offsets[x + 1];
+    };
+    G.resize(n, [&](uint32_t x) {return rowEnd(x) - offsets[x];});
+
+    tbb::parallel_for(tbb::blocked_range<uint32_t>(0, n), [&](tbb::blocked_range<uint32_t> r) {
+        for (uint32_t x = r.begin(); x < r.end(); ++x) {
+            std::copy(neighbors.begin() + offsets[x], neighbors.begin() + rowEnd(x), G[x].begin());
+        }
+    });
 
     return G;
 }
 
+/*
+Maps the (size) bytes of the open file (fd) copy-on-write, so its pages are shared through the 
+page cache with every other run until written to; the mapping is unmapped with its last owner
+*/
+std::shared_ptr<char> mapShared(const int fd, const uint64_t size) {
+    char *f = (char *) mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (f == MAP_FAILED) {
+        std::cout << "Error: could not map the snapshot" << std::endl;
+        exit(1);
+    }
+    return std::shared_ptr<char>(f, [size](char *f) {munmap(f, size);});
+}
+
+/*
+Loads the binary CSR snapshot of (size) bytes from (start) in (mapping)
+The file's offsets and neighbors are the graph's CSR arrays, so the graph is a view of them 
+that keeps the mapping alive, and nothing is copied
+The header and the offsets are checked first, so a corrupt or truncated file is rejected 
+instead of being read out of bounds; |E| in the header is not compared to the neighbors, 
+since it is the count of the input (a cache holds the graph after preprocessing)
+*/
+graph readBinaryGraph(const std::shared_ptr<char>& mapping, uint64_t start, uint64_t size, uint64_t& nEdge, uint32_t& vLeft, uint32_t& vRight) {
+    char *f = mapping.get() + start;
+    if (size < sizeof(csrHeader)) {
+        std::cout << "Error: truncated snapshot" << std::endl;
+        exit(1);
+    }
+    if (memcmp(f, CSR_MAGIC, sizeof(CSR_MAGIC)) != 0) {
+        std::cout << "Error: not a snapshot" << std::endl;
+        exit(1);
+    }
+    const csrHeader *header = (const csrHeader *) f;
+    if (header->version != CSR_VERSION) {
+        std::cout << "Error: unsupported snapshot version " << header->version << std::endl;
+        exit(1);
+    }
+    nEdge = header->nEdge;
+    vLeft = header->vLeft;
+    vRight = header->vRight;
+
+    const uint64_t n = (uint64_t) vLeft + vRight;
+    if (n > UINT32_MAX || (n + 1) * sizeof(uint64_t) > size - sizeof(csrHeader)) {
+        std::cout << "Error: truncated snapshot" << std::endl;
+        exit(1);
+    }
+    uint64_t *offsets = (uint64_t *) (f + sizeof(csrHeader));
+    uint32_t *neighbors = (uint32_t *) (offsets + n + 1);
+    const uint64_t numNeighbors = (size - sizeof(csrHeader) - (n + 1) * sizeof(uint64_t)) / sizeof(uint32_t);
+    if (offsets[n] > numNeighbors) {
+        std::cout << "Error: truncated snapshot" << std::endl;
+        exit(1);
+    }
+
+    // every row must start where the previous one ends, or at the first neighbor
+    const bool ordered = offsets[0] == 0 && tbb::parallel_reduce(tbb::blocked_range<uint64_t>(0, n), true,
+        [&](tbb::blocked_range<uint64_t> r, bool ok) {
+            for (uint64_t x = r.begin(); x < r.end() && ok; ++x) {
+                ok = offsets[x] <= offsets[x + 1];
+            }
+            return ok;
+        },
+        [](bool a, bool b) {
+            return a && b;
+        }
+    );
+    if (!ordered) {
+        std::cout << "Error: corrupt snapshot offsets" << std::endl;
+        exit(1);
+    }
+
+    graph G;
+    G.offsets.view(offsets, n + 1, mapping);
+    G.neighbors.view(neighbors, offsets[n], mapping);
+
+    return G;
+}
+
+// writes the graph (G) in the binary CSR snapshot layout to (out) and returns whether all writes succeeded
+bool writeCSR(FILE *out, const graph& G, const uint64_t nEdge, const uint32_t vLeft, const uint32_t vRight) {
+    const uint32_t n = vLeft + vRight;
+
+    csrHeader header = {};
+    memcpy(header.magic, CSR_MAGIC, sizeof(CSR_MAGIC));
+    header.version = CSR_VERSION;
+    header.vLeft = vLeft;
+    header.vRight = vRight;
+    header.nEdge = nEdge;
+
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+    ok = ok && fwrite(G.offsets.data(), sizeof(uint64_t), n + 1, out) == n + 1;
+    ok = ok && fwrite(G.neighbors.data(), sizeof(uint32_t), G.offsets[n], out) == G.offsets[n];
+    return ok;
+}
+
+// writes the graph (G) as a binary CSR snapshot which readGraph loads without parsing
+void writeGraph(const char *filename, const graph& G, const uint64_t nEdge, const uint32_t vLeft, const uint32_t vRight) {
+    FILE *out = fopen(filename, "wb");
+    if (out == NULL) {
+        std::cout << "Error: could not open " << filename << " for writing" << std::endl;
+        exit(1);
+    }
+
+    const bool ok = writeCSR(out, G, nEdge, vLeft, vRight);
+    if (fclose(out) != 0 || !ok) {
+        std::cout << "Error: could not write " << filename << std::endl;
+        exit(1);
+    }
+}
+
+// hashes the bytes [begin, end) 8 at a time
+uint64_t hashBytes(const char *begin, const char *end) {
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ (end - begin);
+    auto mix = [](uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return x;
+    };
+    const char *p = begin;
+    for (; p + 8 <= end; p += 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        h = (h ^ mix(w)) * 0x100000001b3ULL;
+    }
+    uint64_t w = 0;
+    memcpy(&w, p, end - p);
+    return mix(h ^ mix(w));
+}
+
+// identifies the contents of an input file; the content hash is computed over chunks in parallel
+fileFingerprint getFingerprint(const char *filename) {
+    fileFingerprint fp = {};
+    struct stat s;
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0 || fstat(fd, &s) != 0) {
+        std::cout << "Error: could not open " << filename << std::endl;
+        exit(1);
+    }
+    fp.size = s.st_size;
+    fp.mtimeSec = s.st_mtim.tv_sec;
+    fp.mtimeNsec = s.st_mtim.tv_nsec;
+
+    if (fp.size > 0) {
+        const char *f = (const char *) mmap(0, fp.size, PROT_READ, MAP_PRIVATE, fd, 0);
+        const uint64_t numChunks = (fp.size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        std::vector<uint64_t> chunkHashes(numChunks);
+        tbb::parallel_for(tbb::blocked_range<uint64_t>(0, numChunks, 1), [&](tbb::blocked_range<uint64_t> r) {
+            for (uint64_t i = r.begin(); i < r.end(); ++i) {
+                chunkHashes[i] = hashBytes(f + i * CHUNK_SIZE, f + std::min(fp.size, (i + 1) * CHUNK_SIZE));
+            }
+        });
+        fp.contentHash = hashBytes((const char *) chunkHashes.data(), (const char *) (chunkHashes.data() + numChunks));
+        munmap((void *) f, fp.size);
+    }
+    close(fd);
+
+    return fp;
+}
+
+// the loader options that change the graph read from an input, as stored in its cache
+uint32_t loadOptions() {
+    return remapMode() | (normalizing() ? 0 : 1 << 8);
+}
+
+/*
+Returns the path of the preprocessed graph cache of (filename) if caching is enabled, otherwise an empty string
+Only regular files are cached, since pipes and the standard input cannot be fingerprinted
+*/
+std::string cachePath(const char *filename) {
+    const char *enabled = getenv("PAR6CYCLE_CACHE");
+    struct stat s;
+    if (enabled == NULL || strcmp(enabled, "0") == 0 || stat(filename, &s) != 0 || !S_ISREG(s.st_mode)) {
+        return "";
+    }
+    return std::string(filename) + ".p6cache";
+}
+
+/*
+Loads the preprocessed graph of (filename) from its cache if caching is enabled
+and the cache was written for the current contents of the file
+Returns false if the graph still has to be read and preprocessed
+*/
+bool readCache(const char *filename, graph& G, uint64_t& nEdge, uint32_t& vLeft, uint32_t& vRight) {
+    const std::string path = cachePath(filename);
+    if (path.empty()) {
+        return false;
+    }
+
+    struct stat s;
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    fstat(fd, &s);
+    const uint64_t size = s.st_size;
+    if (size < sizeof(cacheHeader) + sizeof(csrHeader)) {
+        close(fd);
+        return false;
+    }
+
+    const std::shared_ptr<char> mapping = mapShared(fd, size);
+    const char *f = mapping.get();
+    const cacheHeader *header = (const cacheHeader *) f;
+    const fileFingerprint fp = getFingerprint(filename);
+
+    bool hit = memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 && header->version == CACHE_VERSION &&
+        header->options == loadOptions() && memcmp(&header->input, &fp, sizeof(fp)) == 0 &&
+        memcmp(f + sizeof(cacheHeader), CSR_MAGIC, sizeof(CSR_MAGIC)) == 0;
+    if (hit) {
+        G = readBinaryGraph(mapping, sizeof(cacheHeader), size - sizeof(cacheHeader), nEdge, vLeft, vRight);
+        std::cout << "Loaded preprocessed graph from " << path << std::endl;
+    }
+
+    // the graph keeps the mapping of a hit, which outlives the descriptor
+    close(fd);
+    return hit;
+}
+
+/*
+Writes the preprocessed graph (G) to the cache of (filename) if caching is enabled
+The new IDs of the original nodes are not stored, as nothing that loads a cache reports nodes
+The cache is written to a temporary file first so concurrent runs never see a partial cache
+*/
+void writeCache(const char *filename, const graph& G, const uint64_t nEdge, const uint32_t vLeft, const uint32_t vRight) {
+    const std::string path = cachePath(filename);
+    if (path.empty()) {
+        return;
+    }
+
+    cacheHeader header = {};
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.options = loadOptions();
+    header.input = getFingerprint(filename);
+
+    const std::string tmpPath = path + ".tmp" + std::to_string(getpid());
+    FILE *out = fopen(tmpPath.c_str(), "wb");
+    if (out == NULL) {
+        std::cout << "Warning: could not write cache " << path << std::endl;
+        return;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+    ok = ok && writeCSR(out, G, nEdge, vLeft, vRight);
+    ok = fclose(out) == 0 && ok;
+
+    if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::cout << "Warning: could not write cache " << path << std::endl;
+        unlink(tmpPath.c_str());
+    }
+}
+
+/*
+Streams an edge list through a fixed pool of blocks:
+    - One thread fills blocks with (fill) and cuts each block after its last complete record,
+      carrying the partial record over to the next block
+    - The TBB workers parse the blocks into per-worker edge buffers and return them to the pool
+    - Unless (format) is given, the format is sniffed and the header is parsed from the first block 
+      and (format) is set to the sniffed format; a given format's input has no header
+(fill)(dst, n) writes up to n bytes to dst and only returns fewer than n at the end of the input
+(parserFor) returns the parser of the edges of the format
+Peak memory beyond the edge buffers is the block pool, independent of the input size
+*/
+template <typename Chunk>
+std::vector<Chunk> parseEdgesStreamed(const std::function<uint64_t(char *, uint64_t)>& fill, uint64_t& nEdge, uint32_t& vLeft, uint32_t& vRight, 
+                                      chunkParser<Chunk> (*parserFor)(const edgeListFormat&), const edgeListFormat *&format) {
+    const int numWorkers = tbb::this_task_arena::max_concurrency();
+    const int numBlocks = 2 * numWorkers + 2;
+
+    // a block with no data tells a worker to stop
+    struct block {
+        char *data;
+        uint64_t begin;
+        uint64_t end;
+    };
+    std::vector<char> pool(numBlocks * BLOCK_SIZE);
+    tbb::concurrent_bounded_queue<char *> freeBlocks;
+    tbb::concurrent_bounded_queue<block> fullBlocks;
+    for (int i = 0; i < numBlocks; ++i) {
+        freeBlocks.push(pool.data() + i * BLOCK_SIZE);
+    }
+
+    // set by the producer before the first block is handed to the workers if the format is sniffed
+    chunkParser<Chunk> parse = format == NULL ? NULL : parserFor(*format);
+
+    bool recordTooLong = false;
+    std::thread producer([&]() {
+        char *cur = NULL;
+        freeBlocks.pop(cur);
+        uint64_t used = 0, begin = 0;
+        while (true) {
+            used += fill(cur + used, BLOCK_SIZE - used);
+            if (parse == NULL) {
+                format = &sniffFormat(cur, used);
+                begin = format->parseHeader(cur, used, nEdge, vLeft, vRight);
+                parse = parserFor(*format);
+            }
+            if (used < BLOCK_SIZE) {
+                fullBlocks.push({cur, begin, used});
+                break;
+            }
+            const uint64_t end = std::max(begin, format->completeRecords(cur, used));
+            if (end == begin) {
+                recordTooLong = true;
+                break;
+            }
+            char *next = NULL;
+            freeBlocks.pop(next);
+            memcpy(next, cur + end, used - end);
+            fullBlocks.push({cur, begin, end});
+            cur = next;
+            used -= end;
+            begin = 0;
+        }
+        for (int i = 0; i < numWorkers; ++i) {
+            fullBlocks.push({NULL, 0, 0});
+        }
+    });
+
+    std::vector<Chunk> buffers(numWorkers);
+
+    tbb::parallel_for(tbb::blocked_range<int>(0, numWorkers, 1), [&](tbb::blocked_range<int> r) {
+        for (int w = r.begin(); w < r.end(); ++w) {
+            block b;
+            fullBlocks.pop(b);
+            while (b.data != NULL) {
+                parse(b.data + b.begin, b.data + b.end, buffers[w]);
+                freeBlocks.push(b.data);
+                fullBlocks.pop(b);
+            }
+        }
+    });
+
+    producer.join();
+
+    if (recordTooLong) {
+        std::cout << "Error: line longer than " << BLOCK_SIZE << " bytes" << std::endl;
+        exit(1);
+    }
+
+    return buffers;
+}
+
+/*
+Reads a gzip compressed edge list from (source), decompressing on one thread 
+while the TBB workers parse the decompressed blocks
+Concatenated gzip members are read one after another
+(format) is the format of a headerless input, or NULL to sniff it as in parseEdgesStreamed
+*/
+template <typename Chunk>
+std::vector<Chunk> readCompressedEdges(const byteSource& source, uint64_t& nEdge, uint32_t& vLeft, uint32_t& vRight, 
+                                       chunkParser<Chunk> (*parserFor)(const edgeListFormat&), const edgeListFormat *&format) {
+    std::vector<unsigned char> in(READ_SIZE);
+    z_stream strm = {};
+    if (inflateInit2(&strm, 15 + 32) != Z_OK) {
+        std::cout << "Error: could not initialize zlib" << std::endl;
+        exit(1);
+    }
+
+    // inMember is false between gzip members, where the input may end
+    bool inMember = true, finished = false;
+    auto fill = [&](char *dst, uint64_t n) {
+        strm.next_out = (Bytef *) dst;
+        strm.avail_out = n;
+        while (strm.avail_out > 0 && !finished) {
+            if (strm.avail_in == 0) {
+                const int64_t got = source((char *) in.data(), in.size());
+                if (got < 0 || (got == 0 && inMember)) {
+                    std::cout << "Error: truncated or unreadable compressed input" << std::endl;
+                    exit(1);
+                }
+                if (got == 0) {
+                    finished = true;
+                    break;
+                }
+                strm.next_in = in.data();
+                strm.avail_in = got;
+            }
+            if (!inMember) {
+                inflateReset(&strm);
+                inMember = true;
+            }
+            const int ret = inflate(&strm, Z_NO_FLUSH);
+            if (ret == Z_STREAM_END) {
+                inMember = false;
+            }
+            else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+                std::cout << "Error: corrupt compressed input" << std::endl;
+                exit(1);
+            }
+        }
+        return n - strm.avail_out;
+    };
+
+    std::vector<Chunk> buffers = parseEdgesStreamed(fill, nEdge, vLeft, vRight, parserFor, format);
+    inflateEnd(&strm);
+    return buffers;
+}
+
+// returns a source reading (fd) from its current position; interrupted reads are retried
+byteSource fdSource(int fd) {
+    return [fd](char *dst, uint64_t n) {
+        ssize_t got;
+        do {
+            got = read(fd, dst, n);
+        } while (got < 0 && errno == EINTR);
+        return (int64_t) got;
+    };
+}
+
+/*
+Reads an edge list from a pipe, terminal or other input (fd) that cannot be mapped, as it arrives
+The first bytes tell whether the input is gzip compressed; either way it is parsed through 
+the bounded block pool of parseEdgesStreamed, so nothing is buffered beyond the blocks and the edges
+*/
+template <typename Chunk>
+std::vector<Chunk> readStreamedEdges(int fd, uint64_t& nEdge, uint32_t& vLeft, uint32_t& vRight, 
+                                     chunkParser<Chunk> (*parserFor)(const edgeListFormat&)) {
+    const byteSource input = fdSource(fd);
+    char head[sizeof(CSR_MAGIC)];
+    uint64_t headSize = 0, headPos = 0;
+    int64_t got = 1;
+    while (headSize < sizeof(head) && got > 0) {
+        got = input(head + headSize, sizeof(head) - headSize);
+        headSize += std::max(got, (int64_t) 0);
+    }
+    if (got < 0) {
+        std::cout << "Error: could not read input" << std::endl;
+        exit(1);
+    }
+    if (headSize == sizeof(CSR_MAGIC) && memcmp(head, CSR_MAGIC, sizeof(CSR_MAGIC)) == 0) {
+        std::cout << "Error: binary CSR snapshots must be read from a regular file" << std::endl;
+        exit(1);
+    }
+
+    // the bytes read to identify the input are returned first
+    const byteSource source = [&](char *dst, uint64_t n) {
+        if (headPos < headSize) {
+            const uint64_t count = std::min(n, headSize - headPos);
+            memcpy(dst, head + headPos, count);
+            headPos += count;
+            return (int64_t) count;
+        }
+        return input(dst, n);
+    };
+
+    const edgeListFormat *format = NULL;
+    if (headSize >= 2 && (unsigned char) head[0] == 0x1f && (unsigned char) head[1] == 0x8b) {
+        return readCompressedEdges(source, nEdge, vLeft, vRight, parserFor, format);
+    }
+
+    auto fill = [&](char *dst, uint64_t n) {
+        uint64_t filled = 0;
+        while (filled < n) {
+            const int64_t got = source(dst + filled, n - filled);
+            if (got < 0) {
+                std::cout << "Error: could not read input" << std::endl;
+                exit(1);
+            }
+            if (got == 0) break;
+            filled += got;
+        }
+        return filled;
+    };
+    return parseEdgesStreamed(fill, nEdge, vLeft, vRight, parserFor, format);
+}
+
+inline bool isCompressed(const char *f, uint64_t size) {
+    return size >= 2 && (unsigned char) f[0] == 0x1f && (unsigned char) f[1] == 0x8b;
+}
+
+// an open input file; regular files are mapped at (f), others have a NULL (f)
+struct inputFile {
+    int fd;
+    char *f;
+    uint64_t size;
+};
+
+// opens (filename), or the standard input if it is "-", and maps it if it is a regular file
+inputFile openInput(const char *filename) {
+    inputFile in = {strcmp(filename, "-") == 0 ? STDIN_FILENO : open(filename, O_RDONLY), NULL, 0};
+    struct stat s;
+    if (in.fd < 0 || fstat(in.fd, &s) != 0) {
+        std::cout << "Error: could not open " << filename << std::endl;
+        exit(1);
+    }
+    if (S_ISREG(s.st_mode) && s.st_size > 0) {
+        in.size = s.st_size;
+        in.f = (char *) mmap(0, in.size, PROT_READ, MAP_PRIVATE, in.fd, 0);
+    }
+    return in;
+}
+
+void closeInput(inputFile& in) {
+    if (in.f != NULL) {
+        munmap(in.f, in.size);
+    }
+    close(in.fd);
+}
+
+/*
+Lists the shards of a sharded input (path): the files of a directory or the files matching a glob pattern, in name order
+Hidden files, files starting with '_' (e.g. Spark's _SUCCESS) and checksum files (*.crc) are not shards
+(header) is set to the "_header" file next to the shards if there is one
+Returns false if (path) is a single input
+*/
+bool listShards(const char *path, std::vector<std::string>& shards, std::string& header) {
+    struct stat s;
+    std::vector<std::string> paths;
+    std::string dir;
+    if (stat(path, &s) == 0) {
+        if (!S_ISDIR(s.st_mode)) {
+            return false;
+        }
+        dir = path;
+        DIR *d = opendir(path);
+        if (d == NULL) {
+            std::cout << "Error: could not open " << path << std::endl;
+            exit(1);
+        }
+        while (struct dirent *entry = readdir(d)) {
+            paths.push_back(dir + "/" + entry->d_name);
+        }
+        closedir(d);
+    }
+    else if (strpbrk(path, "*?[") != NULL) {
+        glob_t matches;
+        if (glob(path, 0, NULL, &matches) == 0) {
+            for (size_t i = 0; i < matches.gl_pathc; ++i) {
+                paths.push_back(matches.gl_pathv[i]);
+            }
+        }
+        globfree(&matches);
+        const char *slash = strrchr(path, '/');
+        dir = slash == NULL ? "." : std::string(path, slash - path);
+    }
+    else {
+        return false;
+    }
+
+    for (const std::string& p : paths) {
+        const std::string name = p.substr(p.rfind('/') + 1);
+        const bool isCrc = name.size() >= 4 && name.compare(name.size() - 4, 4, ".crc") == 0;
+        if (name[0] == '.' || name[0] == '_' || isCrc || stat(p.c_str(), &s) != 0 || !S_ISREG(s.st_mode)) {
+            continue;
+        }
+        shards.push_back(p);
+    }
+    std::sort(shards.begin(), shards.end());
+    if (shards.empty()) {
+        std::cout << "Error: no input files in " << path << std::endl;
+        exit(1);
+    }
+
+    header = dir + "/_header";
+    if (stat(header.c_str(), &s) != 0) {
+        header.clear();
+    }
+    return true;
+}
+
+/*
+Parses the edges of the input files (files) into chunks with the parser (parserFor) returns for their format
+A single input may be a pipe or other stream; the files of a sharded input must be regular files:
+    - The header is read from the (header) file if given, otherwise from the first file, 
+      and the other files only hold edges in the same format
+    - Text files take the format of a header file; binary pair files are recognized as such
+    - The mapped files are split into chunks which are all parsed together in parallel
+    - Gzip compressed files are streamed one after another, each through its own pipeline
+*/
+template <typename Chunk>
+std::vector<Chunk> readEdges(const std::vector<std::string>& files, const std::string& header, uint64_t& nEdge, uint32_t& vLeft, uint32_t& vRight, 
+                             chunkParser<Chunk> (*parserFor)(const edgeListFormat&)) {
+    std::vector<inputFile> inputs;
+    for (const std::string& file : files) {
+        inputs.push_back(openInput(file.c_str()));
+        if (inputs.back().f == NULL && files.size() > 1) {
+            std::cout << "Error: " << file << " is empty or not a regular file" << std::endl;
+            exit(1);
+        }
+    }
+    if (inputs.size() == 1 && inputs[0].f == NULL) {
+        std::vector<Chunk> buffers = readStreamedEdges(inputs[0].fd, nEdge, vLeft, vRight, parserFor);
+        closeInput(inputs[0]);
+        return buffers;
+    }
+
+    nEdge = 0, vLeft = 0, vRight = 0;
+    const edgeListFormat *format = NULL;
+    if (!header.empty()) {
+        inputFile in = openInput(header.c_str());
+        if (in.f != NULL) {
+            format = &sniffFormat(in.f, in.size);
+            format->parseHeader(in.f, in.size, nEdge, vLeft, vRight);
+        }
+        closeInput(in);
+    }
+
+    std::vector<Chunk> buffers;
+    std::vector<mappedRange> ranges;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        const inputFile& in = inputs[i];
+        if (isCompressed(in.f, in.size)) {
+            std::vector<Chunk> part = readCompressedEdges(fdSource(in.fd), nEdge, vLeft, vRight, parserFor, format);
+            std::move(part.begin(), part.end(), std::back_inserter(buffers));
+            continue;
+        }
+        uint64_t begin = 0;
+        if (format == NULL) {
+            format = &sniffFormat(in.f, in.size);
+            begin = format->parseHeader(in.f, in.size, nEdge, vLeft, vRight);
+        }
+        else if (i == 0 && format->text && !sniffFormat(in.f, in.size).text) {
+            format = &sniffFormat(in.f, in.size);
+        }
+        ranges.push_back({in.f, begin, in.size});
+    }
+    if (!ranges.empty()) {
+        std::vector<Chunk> part = parseEdgesParallel(ranges, *format, parserFor(*format));
+        std::move(part.begin(), part.end(), std::back_inserter(buffers));
+    }
+
+    for (inputFile& in : inputs) {
+        closeInput(in);
+    }
+    return buffers;
+}
+
+// returns the identifier mode selected by PAR6CYCLE_REMAP: unset or "0" for none, "string" for strings, otherwise numeric
+uint32_t remapMode() {
+    const char *mode = getenv("PAR6CYCLE_REMAP");
+    if (mode == NULL || strcmp(mode, "0") == 0) {
+        return REMAP_NONE;
+    }
+    return strcmp(mode, "string") == 0 ? REMAP_STRING : REMAP_NUMERIC;
+}
+
+/*
+Reads graph file and converts to a CSR graph
+The file may be a binary CSR snapshot or an edge list in any of the FORMATS, optionally gzip compressed
+Edge lists may also be read from pipes, or from the standard input if (filename) is "-", 
+or be sharded over the files of a directory or glob pattern (see listShards)
+If remapping is enabled, the node identifiers of an edge list may be arbitrary and are mapped 
+to dense IDs; the original identifier of every node is stored in (ids)
+*/
+graph readGraph(const char *filename, uint64_t& nEdge, uint32_t& vLeft, uint32_t& vRight, idMap& ids) {
+
+    std::vector<std::string> files;
+    std::string header;
+    if (!listShards(filename, files, header)) {
+        // only regular files are probed for a snapshot, as opening the standard input or a pipe 
+        // once more would not see the bytes read by the probe (or, for "-", would not work at all)
+        struct stat s;
+        if (strcmp(filename, "-") != 0 && stat(filename, &s) == 0 && S_ISREG(s.st_mode)) {
+            inputFile in = openInput(filename);
+            if (in.f != NULL && in.size >= sizeof(CSR_MAGIC) && memcmp(in.f, CSR_MAGIC, sizeof(CSR_MAGIC)) == 0) {
+                graph G = readBinaryGraph(mapShared(in.fd, in.size), 0, in.size, nEdge, vLeft, vRight);
+                closeInput(in);
+                return G;
+            }
+            closeInput(in);
+        }
+        files.push_back(filename);
+    }
+
+    std::vector<edgeList> buffers;
+    const uint32_t remap = remapMode();
+    if (remap == REMAP_NUMERIC) {
+        std::vector<keyChunk> chunks = readEdges(files, header, nEdge, vLeft, vRight, numericParser);
+        buffers = remapIDs<uint64_t>(chunks, nEdge, vLeft, vRight, ids.leftIDs, ids.rightIDs);
+    }
+    else if (remap == REMAP_STRING) {
+        std::vector<keyChunk> chunks = readEdges(files, header, nEdge, vLeft, vRight, stringParser);
+        buffers = remapIDs<std::string_view>(chunks, nEdge, vLeft, vRight, ids.leftNames, ids.rightNames);
+    }
+    else {
+        buffers = readEdges(files, header, nEdge, vLeft, vRight, edgeParser);
+        completeCounts(buffers, nEdge, vLeft, vRight);
+    }
+
+    return buildGraph(buffers, nEdge, vLeft, vRight);
+}
+
+graph readGraph(const char *filename, uint64_t& nEdge, uint32_t& vLeft, uint32_t& vRight) {
+    idMap ids;
+    return readGraph(filename, nEdge, vLeft, vRight, ids);
+}
+
+// returns the original identifier of node (x) of a graph read with (ids), or x itself if it was not remapped
+std::string originalID(const idMap& ids, const uint32_t x, const uint32_t vLeft) {
+    if (x < vLeft) {
+        if (x < ids.leftIDs.size()) return std::to_string(ids.leftIDs[x]);
+        if (x < ids.leftNames.size()) return ids.leftNames[x];
+        return std::to_string(x);
+    }
+    if (x - vLeft < ids.rightIDs.size()) return std::to_string(ids.rightIDs[x - vLeft]);
+    if (x - vLeft < ids.rightNames.size()) return ids.rightNames[x - vLeft];
+    return std::to_string(x - vLeft);
+}
+
+// writes the original identifier of every node, one per line, left set first
+void writeIDs(const char *filename, const idMap& ids, const uint32_t vLeft, const uint32_t vRight) {
+    FILE *out = fopen(filename, "w");
+    if (out == NULL) {
+        std::cout << "Error: could not open " << filename << " for writing" << std::endl;
+        exit(1);
+    }
+
+    bool ok = true;
+    for (uint32_t x = 0; ok && x < vLeft + vRight; ++x) {
+        ok = fprintf(out, "%s\n", originalID(ids, x, vLeft).c_str()) > 0;
+    }
+    if (fclose(out) != 0 || !ok) {
+        std::cout << "Error: could not write " << filename << std::endl;
+        exit(1);
+    }
+}
+
+// returns how the work is spread over NUMA nodes, selected by PAR6CYCLE_NUMA: "1" or "interleave", "partition", otherwise off
+uint32_t numaMode() {
+    const char *mode = getenv("PAR6CYCLE_NUMA");
+    if (mode == NULL || strcmp(mode, "0") == 0) {
+        return NUMA_OFF;
+    }
+    if (strcmp(mode, "partition") == 0) {
+        return NUMA_PARTITION;
+    }
+    if (strcmp(mode, "1") == 0 || strcmp(mode, "interleave") == 0) {
+        return NUMA_INTERLEAVE;
+    }
+    std::cout << "Error: invalid PAR6CYCLE_NUMA " << mode << std::endl;
+    exit(1);
+}
+
+const uint32_t NUMA_MODE = numaMode();
+
+// node policies of mbind
+const int MPOL_PREFERRED_NODE = 1;
+const int MPOL_INTERLEAVE_NODES = 3;
+const unsigned MPOL_MOVE_PAGES = 1 << 1;
+
+// node masks passed to mbind cover node IDs below NUMA_MAX_NODES
+const uint32_t NUMA_MAX_NODES = 1024;
+
+struct numaNode {
+    uint32_t id;
+    std::vector<uint32_t> cpus;
+};
+
+// the first line of a sysfs file, or "" if it cannot be read
+std::string readLine(const std::string& path) {
+    std::string line;
+    FILE *f = fopen(path.c_str(), "r");
+    if (f == NULL) {
+        return line;
+    }
+    char buffer[4096];
+    while (fgets(buffer, sizeof(buffer), f) != NULL) {
+        line += buffer;
+        if (line.back() == '\n') {
+            line.pop_back();
+            break;
+        }
+    }
+    fclose(f);
+    return line;
+}
+
+// the numbers of a sysfs list such as "0-3,8-11"
+std::vector<uint32_t> parseList(const std::string& list) {
+    std::vector<uint32_t> numbers;
+    const char *p = list.c_str();
+    while (*p >= '0' && *p <= '9') {
+        char *end;
+        const uint32_t first = strtoul(p, &end, 10);
+        uint32_t last = first;
+        if (*end == '-') {
+            last = strtoul(end + 1, &end, 10);
+        }
+        for (uint32_t x = first; x <= last; ++x) {
+            numbers.push_back(x);
+        }
+        p = *end == ',' ? end + 1 : end;
+    }
+    return numbers;
+}
+
+/*
+The NUMA nodes with CPUs this process may run on, read from /sys/devices/system/node
+Machines with one such node (or without the sysfs tree) have no nodes, and every NUMA 
+function then falls back to the behavior without PAR6CYCLE_NUMA
+*/
+const std::vector<numaNode>& numaTopology() {
+    static const std::vector<numaNode> nodes = [] {
+        std::vector<numaNode> nodes;
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+            return nodes;
+        }
+        for (uint32_t id : parseList(readLine("/sys/devices/system/node/online"))) {
+            if (id >= NUMA_MAX_NODES) {
+                continue;
+            }
+            numaNode node{id, {}};
+            for (uint32_t cpu : parseList(readLine("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist"))) {
+                if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) {
+                    node.cpus.push_back(cpu);
+                }
+            }
+            // nodes of memory only get no share of the work
+            if (!node.cpus.empty()) {
+                nodes.push_back(node);
+            }
+        }
+        if (nodes.size() < 2) {
+            nodes.clear();
+        }
+        return nodes;
+    }();
+    return nodes;
+}
+
+// the number of nodes forEachNode splits the work over, 1 if NUMA mode is off or there is a single node
+uint32_t numaNodes() {
+    if (NUMA_MODE == NUMA_OFF || numaTopology().empty()) {
+        return 1;
+    }
+    return numaTopology().size();
+}
+
+// set on the threads pinned to a node, whose large allocations stay local instead of interleaved
+thread_local bool NODE_LOCAL = false;
+
+// the node the calling thread is pinned to, or -1, and the CPUs it was allowed before
+thread_local int64_t PINNED_NODE = -1;
+thread_local cpu_set_t UNPINNED_CPUS;
+
+// spreads the pages of [first, first + length) over all nodes
+void interleave(void *first, const uint64_t length) {
+#ifdef SYS_mbind
+    unsigned long mask[NUMA_MAX_NODES / 64] = {0};
+    for (const numaNode& node : numaTopology()) {
+        mask[node.id / 64] |= 1UL << (node.id % 64);
+    }
+    // placement is a hint, so a kernel without NUMA support is no error
+    syscall(SYS_mbind, first, length, MPOL_INTERLEAVE_NODES, mask, NUMA_MAX_NODES, 0);
+#endif
+}
+
+// moves the pages holding [first, last) to the memory of node (node) of numaNodes()
+void placeOnNode(const void *first, const void *last, const uint32_t node) {
+    if (numaNodes() == 1 || first >= last) {
+        return;
+    }
+#ifdef SYS_mbind
+    const uintptr_t page = sysconf(_SC_PAGESIZE);
+    const uintptr_t begin = (uintptr_t) first & ~(page - 1);
+    const uintptr_t end = ((uintptr_t) last + page - 1) & ~(page - 1);
+    const uint32_t id = numaTopology()[node].id;
+    unsigned long mask[NUMA_MAX_NODES / 64] = {0};
+    mask[id / 64] |= 1UL << (id % 64);
+    syscall(SYS_mbind, begin, end - begin, MPOL_PREFERRED_NODE, mask, NUMA_MAX_NODES, MPOL_MOVE_PAGES);
+#endif
+}
+
+// restricts the calling thread to the CPUs of node (node) of numaNodes(), after which its large allocations stay on the node
+// threads already there skip the system call
+void pinToNode(const uint32_t node) {
+    if (numaNodes() == 1 || PINNED_NODE == node) {
+        return;
+    }
+    if (PINNED_NODE == -1) {
+        sched_getaffinity(0, sizeof(UNPINNED_CPUS), &UNPINNED_CPUS);
+    }
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (uint32_t cpu : numaTopology()[node].cpus) {
+        CPU_SET(cpu, &cpus);
+    }
+    sched_setaffinity(0, sizeof(cpus), &cpus);
+    PINNED_NODE = node;
+    NODE_LOCAL = true;
+}
+
+// gives a thread pinned by pinToNode its CPUs back, after which its large allocations are interleaved again
+void unpinFromNode() {
+    if (PINNED_NODE == -1) {
+        return;
+    }
+    sched_setaffinity(0, sizeof(UNPINNED_CPUS), &UNPINNED_CPUS);
+    PINNED_NODE = -1;
+    NODE_LOCAL = false;
+}
+
+// pins the threads of the arena of a node while they work in it, so TBB workers are free again when they leave
+struct nodeObserver : tbb::task_scheduler_observer {
+    const uint32_t node;
+    nodeObserver(tbb::task_arena& arena, const uint32_t node) : tbb::task_scheduler_observer(arena), node(node) {
+        arena.initialize();
+        observe(true);
+    }
+    ~nodeObserver() {observe(false);}
+    void on_scheduler_entry(bool /*is_worker*/) override {pinToNode(node);}
+    void on_scheduler_exit(bool /*is_worker*/) override {unpinFromNode();}
+};
+
+// a task arena of the size of a node, whose threads are pinned to it
+struct nodeArena {
+    tbb::task_arena arena;
+    nodeObserver observer;
+    nodeArena(const uint32_t node) : arena(numaTopology()[node].cpus.size()), observer(arena, node) {}
+};
+
+/*
+Splits [begin, end) into numaNodes() consecutive ranges, sized so that the sum of (weight) over 
+each range is proportional to the number of CPUs of its node; returns the numaNodes() + 1 bounds
+*/
+std::vector<uint32_t> numaSplit(const uint32_t begin, const uint32_t end, const std::function<uint64_t(uint32_t)>& weight) {
+    const uint32_t k = numaNodes();
+    std::vector<uint32_t> bounds(k + 1, end);
+    bounds[0] = begin;
+    if (k == 1) {
+        return bounds;
+    }
+    uint64_t total = 0;
+    for (uint32_t x = begin; x < end; ++x) {
+        total += weight(x);
+    }
+    uint64_t totalCpus = 0;
+    for (const numaNode& node : numaTopology()) {
+        totalCpus += node.cpus.size();
+    }
+    uint64_t cpus = 0;
+    uint64_t sum = 0;
+    uint32_t x = begin;
+    for (uint32_t node = 0; node + 1 < k; ++node) {
+        cpus += numaTopology()[node].cpus.size();
+        while (x < end && (long double) sum * totalCpus < (long double) total * cpus) {
+            sum += weight(x++);
+        }
+        bounds[node + 1] = x;
+    }
+    return bounds;
+}
+
+/*
+Runs body(node, first, last) for the numaSplit ranges of [begin, end), each from a thread inside 
+a task arena of that node's size; every thread working in the arena, including body's parallel 
+loops, is pinned to the node until it leaves, so the scratch body allocates is first touched 
+there. Without NUMA nodes, body(0, begin, end) runs on the calling thread
+*/
+void forEachNode(const uint32_t begin, const uint32_t end, const std::function<uint64_t(uint32_t)>& weight, 
+                 const std::function<void(uint32_t, uint32_t, uint32_t)>& body) {
+    const uint32_t k = numaNodes();
+    if (k == 1) {
+        body(0, begin, end);
+        return;
+    }
+    static std::vector<std::unique_ptr<nodeArena>> arenas;
+    if (arenas.empty()) {
+        for (uint32_t node = 0; node < k; ++node) {
+            arenas.emplace_back(new nodeArena(node));
+        }
+    }
+    const std::vector<uint32_t> bounds = numaSplit(begin, end, weight);
+    std::vector<std::thread> threads;
+    for (uint32_t node = 0; node < k; ++node) {
+        threads.emplace_back([&, node] {
+            arenas[node]->arena.execute([&] {body(node, bounds[node], bounds[node + 1]);});
+        });
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+}
+
+// returns how large arrays are backed, selected by PAR6CYCLE_HUGEPAGES: "0" for regular pages, "hugetlb" for hugetlbfs, "1" or "madvise" (default) for transparent huge pages
+uint32_t hugePageMode() {
+    const char *mode = getenv("PAR6CYCLE_HUGEPAGES");
+    if (mode == NULL || strcmp(mode, "1") == 0 || strcmp(mode, "madvise") == 0) {
+        return HUGEPAGES_MADVISE;
+    }
+    if (strcmp(mode, "0") == 0) {
+        return HUGEPAGES_OFF;
+    }
+    if (strcmp(mode, "hugetlb") == 0) {
+        return HUGEPAGES_HUGETLB;
+    }
+    std::cout << "Error: invalid PAR6CYCLE_HUGEPAGES " << mode << std::endl;
+    exit(1);
+}
+
+const uint32_t HUGE_PAGE_MODE = hugePageMode();
+
+// whether an array of (size) bytes is mapped by allocateHuge rather than taken from the heap
+bool mapped(const uint64_t size) {
+    return size >= HUGE_PAGE_SIZE && (HUGE_PAGE_MODE != HUGEPAGES_OFF || NUMA_MODE != NUMA_OFF);
+}
+
+/*
+Allocates (size) bytes for a large array
+Arrays of at least HUGE_PAGE_SIZE are mapped at a 2 MB boundary in whole huge pages, from the 
+reserved hugetlbfs pages if selected and available, otherwise from anonymous memory marked for 
+transparent huge pages; smaller arrays and the regular page mode use the heap
+In NUMA mode, the pages of arrays not allocated by a node's thread (see forEachNode) are 
+interleaved over the nodes, and the regular page mode maps them without marking them
+*/
+void *allocateHuge(uint64_t size) {
+    if (!mapped(size)) {
+        return ::operator new(size);
+    }
+    const uint64_t length = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+
+#ifdef MAP_HUGETLB
+    if (HUGE_PAGE_MODE == HUGEPAGES_HUGETLB) {
+        void *p = mmap(0, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            if (NUMA_MODE != NUMA_OFF && !NODE_LOCAL && numaNodes() > 1) {
+                interleave(p, length);
+            }
+            return p;
+        }
+    }
+#endif
+
+    // the mapping is over-allocated by a huge page and trimmed to the aligned range
+    char *p = (char *) mmap(0, length + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    char *aligned = (char *) (((uintptr_t) p + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1));
+    if (aligned > p) {
+        munmap(p, aligned - p);
+    }
+    munmap(aligned + length, p + HUGE_PAGE_SIZE - aligned);
+#ifdef MADV_HUGEPAGE
+    if (HUGE_PAGE_MODE != HUGEPAGES_OFF) {
+        madvise(aligned, length, MADV_HUGEPAGE);
+    }
+#endif
+    if (NUMA_MODE != NUMA_OFF && !NODE_LOCAL && numaNodes() > 1) {
+        interleave(aligned, length);
+    }
+    return aligned;
+}
+
+// frees the (size) bytes at (p) allocated by allocateHuge
+void freeHuge(void *p, uint64_t size) {
+    if (!mapped(size)) {
+        ::operator delete(p);
+        return;
+    }
+    munmap(p, (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1));
+}
+
 std::chrono::high_resolution_clock::time_point get_time() {return std::chrono::high_resolution_clock::now();}